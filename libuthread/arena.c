@@ -0,0 +1,111 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "arena.h"
+
+/* size of a standard chunk, header included */
+#define ARENA_CHUNK_SIZE 16384
+
+/* number of standard chunks kept for reuse */
+#define ARENA_CACHE_SIZE 64
+
+/* header of a chunk, followed by the memory handed out */
+struct arena_chunk
+{
+    struct arena_chunk *next;       /* next chunk of the arena or the cache */
+    size_t size;                    /* size of the chunk, header included */
+} __attribute__((aligned(ARENA_ALIGN)));
+
+/* usable bytes of a standard chunk */
+#define ARENA_CHUNK_PAYLOAD (ARENA_CHUNK_SIZE - sizeof(struct arena_chunk))
+
+void *arena_grow(struct arena *a, struct arena_cache *cache, size_t size)
+{
+    struct arena_chunk *chunk;
+
+    /* the rounded size and the chunk header must not wrap around */
+    if(size > SIZE_MAX - sizeof(struct arena_chunk) - ARENA_ALIGN)
+        return NULL;
+
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if(!size)
+        return NULL;
+
+    /* large blocks get a chunk of their own, behind the current one */
+    if(size > ARENA_CHUNK_PAYLOAD)
+    {
+        chunk = malloc(sizeof(struct arena_chunk) + size);
+        if(!chunk)
+            return NULL;
+        chunk->size = sizeof(struct arena_chunk) + size;
+        if(a->chunks)
+        {
+            chunk->next = a->chunks->next;
+            a->chunks->next = chunk;
+        }
+        else
+        {
+            chunk->next = NULL;
+            a->chunks = chunk;
+        }
+        return chunk + 1;
+    }
+
+    /* take a standard chunk, preferably from the cache */
+    if(cache->chunks)
+    {
+        chunk = cache->chunks;
+        cache->chunks = chunk->next;
+        cache->length--;
+    }
+    else
+    {
+        chunk = malloc(ARENA_CHUNK_SIZE);
+        if(!chunk)
+            return NULL;
+        chunk->size = ARENA_CHUNK_SIZE;
+    }
+
+    /* the rest of the previous chunk is wasted */
+    chunk->next = a->chunks;
+    a->chunks = chunk;
+    a->next = (char*)(chunk + 1) + size;
+    a->end = (char*)chunk + ARENA_CHUNK_SIZE;
+
+    return chunk + 1;
+}
+
+void arena_release(struct arena *a, struct arena_cache *cache)
+{
+    struct arena_chunk *chunk, *next;
+
+    for(chunk = a->chunks; chunk; chunk = next)
+    {
+        next = chunk->next;
+        if(chunk->size == ARENA_CHUNK_SIZE && cache->length < ARENA_CACHE_SIZE)
+        {
+            chunk->next = cache->chunks;
+            cache->chunks = chunk;
+            cache->length++;
+        }
+        else
+            free(chunk);
+    }
+
+    a->chunks = NULL;
+    a->next = NULL;
+    a->end = NULL;
+}
+
+void arena_cache_destroy(struct arena_cache *cache)
+{
+    struct arena_chunk *chunk;
+
+    while(cache->chunks)
+    {
+        chunk = cache->chunks;
+        cache->chunks = chunk->next;
+        free(chunk);
+    }
+    cache->length = 0;
+}
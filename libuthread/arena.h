@@ -0,0 +1,88 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stddef.h>
+
+/*
+ * struct arena - Bump allocator
+ *
+ * An arena hands out memory from chunks by moving a pointer forward, and only
+ * gives it back all at once when released. Chunks of the standard size are
+ * kept in a cache when released, so that short-lived arenas do not go back to
+ * malloc() for every chunk.
+ *
+ * A zeroed arena is empty and ready to use.
+ */
+struct arena_chunk;
+
+/*
+ * struct arena_cache - Cache of standard chunks
+ *
+ * A cache can be shared by several arenas, as long as they are not grown or
+ * released concurrently. A zeroed cache is empty and ready to use.
+ */
+struct arena_cache {
+	struct arena_chunk *chunks;	/* released chunks */
+	int length;			/* number of chunks in the cache */
+};
+
+struct arena {
+	struct arena_chunk *chunks;	/* chunks of the arena, current first */
+	char *next;			/* next free byte of the current chunk */
+	char *end;			/* end of the current chunk */
+};
+
+/* Alignment of the blocks returned by arenas */
+#define ARENA_ALIGN 16
+
+/*
+ * arena_alloc - Allocate from the current chunk of an arena
+ * @a: Arena to allocate from
+ * @size: Number of bytes to allocate
+ *
+ * Return: Pointer to a block of @size bytes aligned on ARENA_ALIGN, or NULL
+ * if @size is 0 or if the block does not fit in the current chunk (use
+ * arena_grow() then)
+ */
+static inline void *arena_alloc(struct arena *a, size_t size)
+{
+	char *block = a->next;
+
+	size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	if (!size || size > (size_t)(a->end - block))
+		return NULL;
+
+	a->next = block + size;
+	return block;
+}
+
+/*
+ * arena_grow - Allocate from a new chunk of an arena
+ * @a: Arena to allocate from
+ * @cache: Cache to take a standard chunk from
+ * @size: Number of bytes to allocate
+ *
+ * Blocks larger than a standard chunk get a chunk of their own, and the
+ * current chunk remains the one allocated from.
+ *
+ * Return: Pointer to a block of @size bytes aligned on ARENA_ALIGN, or NULL
+ * if @size is 0 or too large, or in case of memory allocation failure
+ */
+void *arena_grow(struct arena *a, struct arena_cache *cache, size_t size);
+
+/*
+ * arena_release - Free all the memory of an arena
+ * @a: Arena to release
+ * @cache: Cache to give standard chunks back to
+ *
+ * The arena is empty afterwards and can be allocated from again.
+ */
+void arena_release(struct arena *a, struct arena_cache *cache);
+
+/*
+ * arena_cache_destroy - Free the chunks of a cache
+ * @cache: Cache to empty
+ */
+void arena_cache_destroy(struct arena_cache *cache);
+
+#endif /* _ARENA_H */
@@ -0,0 +1,113 @@
+#include <limits.h>
+#include <stddef.h>
+
+#include "barrier.h"
+#include "preempt.h"
+#include "uthread.h"
+
+/* success and failure defines */
+#define SUCCESS 0
+#define FAILURE -1
+
+int uthread_barrier_init(uthread_barrier_t *barrier, int count)
+{
+    if(!barrier || count <= 0)
+        return FAILURE;
+
+    barrier->count = count;
+    barrier->arrived = 0;
+    barrier->generation = 0;
+
+    return SUCCESS;
+}
+
+int uthread_barrier_wait(uthread_barrier_t *barrier)
+{
+    int generation;
+
+    if(!barrier)
+        return FAILURE;
+
+    /* disable preemption
+     * make sure two threads cannot both see themselves as the last one
+     */
+    preempt_disable();
+
+    generation = barrier->generation;
+    if(++barrier->arrived == barrier->count)
+    {
+        /* open the barrier and get it ready for the next generation */
+        barrier->arrived = 0;
+        barrier->generation = generation == INT_MAX ? 0 : generation + 1;
+        preempt_enable();
+
+        /* release every waiter at once */
+        uthread_unpark(&barrier->generation, INT_MAX);
+        return UTHREAD_BARRIER_SERIAL_THREAD;
+    }
+
+    /* re-enable preemption before parking, which disables it itself */
+    preempt_enable();
+
+    /* parking fails right away if the barrier opened in between */
+    while(barrier->generation == generation)
+    {
+        if(uthread_park(&barrier->generation, generation) == FAILURE &&
+            barrier->generation == generation)
+            return FAILURE;
+    }
+
+    return SUCCESS;
+}
+
+int uthread_latch_init(uthread_latch_t *latch, int count)
+{
+    if(!latch || count < 0)
+        return FAILURE;
+
+    latch->count = count;
+
+    return SUCCESS;
+}
+
+int uthread_latch_count_down(uthread_latch_t *latch)
+{
+    if(!latch)
+        return FAILURE;
+
+    /* disable preemption
+     * make sure exactly one thread brings the count to zero
+     */
+    preempt_disable();
+
+    if(latch->count > 0 && --latch->count == 0)
+    {
+        preempt_enable();
+
+        /* release every waiter at once */
+        uthread_unpark(&latch->count, INT_MAX);
+        return SUCCESS;
+    }
+
+    preempt_enable();
+
+    return SUCCESS;
+}
+
+int uthread_latch_wait(uthread_latch_t *latch)
+{
+    int count;
+
+    if(!latch)
+        return FAILURE;
+
+    /* parking fails right away if the count changed in between */
+    while((count = latch->count) > 0)
+    {
+        if(uthread_park(&latch->count, count) == FAILURE &&
+            latch->count == count)
+            return FAILURE;
+    }
+
+    return SUCCESS;
+}
@@ -0,0 +1,92 @@
+#ifndef _BARRIER_H
+#define _BARRIER_H
+
+/*
+ * uthread_barrier_t - Barrier type
+ *
+ * A barrier makes a fixed number of threads wait for each other: every thread
+ * calling uthread_barrier_wait() blocks until the last one arrives, at which
+ * point they are all released together and the barrier can be reused for the
+ * next step.
+ *
+ * A barrier is a plain structure which does not need to be destroyed, waiting
+ * threads are parked on its generation word.
+ */
+typedef struct {
+	int count;		/* number of threads to wait for */
+	int arrived;		/* number of threads arrived in this generation */
+	int generation;		/* bumped every time the barrier opens */
+} uthread_barrier_t;
+
+/* Value returned to exactly one thread per barrier generation */
+#define UTHREAD_BARRIER_SERIAL_THREAD 1
+
+/*
+ * uthread_barrier_init - Initialize a barrier
+ * @barrier: Barrier to initialize
+ * @count: Number of threads which must reach the barrier for it to open
+ *
+ * Return: -1 if @barrier is NULL or if @count is not positive. 0 otherwise.
+ */
+int uthread_barrier_init(uthread_barrier_t *barrier, int count);
+
+/*
+ * uthread_barrier_wait - Wait on a barrier
+ * @barrier: Barrier to wait on
+ *
+ * Block the calling thread until @count threads (as given at initialization)
+ * have called this function on @barrier. The last thread to arrive does not
+ * block: it releases every waiter at once and returns right away.
+ *
+ * Return: UTHREAD_BARRIER_SERIAL_THREAD for the last thread to arrive, 0 for
+ * the others. -1 if @barrier is NULL, or if no other thread was left to run
+ * and open the barrier.
+ */
+int uthread_barrier_wait(uthread_barrier_t *barrier);
+
+/*
+ * uthread_latch_t - Countdown latch type
+ *
+ * A latch starts with a count which threads decrement. Threads waiting on the
+ * latch are released once the count reaches zero, after which the latch stays
+ * open for good.
+ *
+ * Like barriers, latches need no destruction.
+ */
+typedef struct {
+	int count;		/* remaining count downs before opening */
+} uthread_latch_t;
+
+/*
+ * uthread_latch_init - Initialize a latch
+ * @latch: Latch to initialize
+ * @count: Number of count downs before the latch opens
+ *
+ * Return: -1 if @latch is NULL or if @count is negative. 0 otherwise.
+ */
+int uthread_latch_init(uthread_latch_t *latch, int count);
+
+/*
+ * uthread_latch_count_down - Decrement the count of a latch
+ * @latch: Latch to count down
+ *
+ * The thread reaching zero releases every thread waiting on @latch. Counting
+ * down an open latch has no effect.
+ *
+ * Return: -1 if @latch is NULL. 0 otherwise.
+ */
+int uthread_latch_count_down(uthread_latch_t *latch);
+
+/*
+ * uthread_latch_wait - Wait for a latch to open
+ * @latch: Latch to wait on
+ *
+ * Block the calling thread until the count of @latch reaches zero. Return
+ * right away if it is already open.
+ *
+ * Return: -1 if @latch is NULL, or if no other thread was left to run and
+ * open the latch. 0 otherwise.
+ */
+int uthread_latch_wait(uthread_latch_t *latch);
+
+#endif /* _BARRIER_H */
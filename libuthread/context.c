@@ -1,5 +1,7 @@
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "context.h"
 #include "preempt.h"
@@ -20,14 +22,93 @@ void uthread_ctx_switch(uthread_ctx_t *prev, uthread_ctx_t *next)
 	}
 }
 
+/*
+ * Each stack is preceded by a header recording how it can be measured
+ */
+struct stack_header {
+	int painted;			/* Whether unused bytes hold STACK_PAINT */
+} __attribute__((aligned(16)));
+
+/* Byte written over stacks to find out how deep they were used */
+#define STACK_PAINT 0xa5
+
+/* Whether new stacks are painted (per kernel thread, like schedulers) */
+static __thread int paint_stacks;
+
+/*
+ * Context from which the contexts of new threads can be copied, per kernel
+ * thread as it must outlive the threads of the scheduler running there
+ */
+static __thread uthread_ctx_t template_ctx;
+static __thread int template_ready;
+
 void *uthread_ctx_alloc_stack(void)
 {
-	return malloc(UTHREAD_STACK_SIZE);
+	struct stack_header *header;
+
+	header = malloc(sizeof(struct stack_header) + UTHREAD_STACK_SIZE);
+	if (!header)
+		return NULL;
+
+	header->painted = paint_stacks;
+	if (paint_stacks)
+		memset(header + 1, STACK_PAINT, UTHREAD_STACK_SIZE);
+
+	return header + 1;
 }
 
 void uthread_ctx_destroy_stack(void *top_of_stack)
 {
-	free(top_of_stack);
+	if (!top_of_stack)
+		return;
+
+	free((struct stack_header *)top_of_stack - 1);
+}
+
+void uthread_ctx_paint_stacks(int enable)
+{
+	paint_stacks = enable;
+}
+
+long uthread_ctx_stack_used(void *top_of_stack)
+{
+	struct stack_header *header = (struct stack_header *)top_of_stack - 1;
+	const uint64_t pattern = 0x0101010101010101ULL * STACK_PAINT;
+	const uint64_t *word = top_of_stack;
+	unsigned char *lowest;
+	long used;
+
+	/* Paint the stack for next time if it was allocated before painting */
+	if (!header->painted) {
+		if (paint_stacks) {
+			memset(top_of_stack, STACK_PAINT, UTHREAD_STACK_SIZE);
+			header->painted = 1;
+		}
+		return -1;
+	}
+
+	/*
+	 * Stacks grow down from the end of the segment, the lowest byte which
+	 * lost the paint is the deepest point reached
+	 */
+	while ((char *)word < (char *)top_of_stack + UTHREAD_STACK_SIZE &&
+	       *word == pattern)
+		word++;
+	lowest = (unsigned char *)word;
+	while (lowest < (unsigned char *)top_of_stack + UTHREAD_STACK_SIZE &&
+	       *lowest == STACK_PAINT)
+		lowest++;
+	used = (unsigned char *)top_of_stack + UTHREAD_STACK_SIZE - lowest;
+
+	/* Only the used part needs to be painted again */
+	memset(lowest, STACK_PAINT, used);
+
+	return used;
+}
+
+long uthread_ctx_stack_size(void)
+{
+	return UTHREAD_STACK_SIZE;
 }
 
 /*
@@ -74,3 +155,40 @@ int uthread_ctx_init(uthread_ctx_t *uctx, void *top_of_stack,
 	return 0;
 }
 
+
+int uthread_ctx_init_from_template(uthread_ctx_t *uctx, void *top_of_stack,
+				   uthread_func_t func, void *arg)
+{
+	/*
+	 * Capture the template once, later contexts are plain copies. The
+	 * template must outlive the copies as they may still refer to its
+	 * saved floating point state until they run for the first time.
+	 */
+	if (!template_ready) {
+		if (getcontext(&template_ctx))
+			return -1;
+		template_ready = 1;
+	}
+	*uctx = template_ctx;
+
+	uctx->uc_stack.ss_sp = top_of_stack;
+	uctx->uc_stack.ss_size = UTHREAD_STACK_SIZE;
+	makecontext(uctx, (void (*)(void)) uthread_ctx_bootstrap,
+		    2, func, arg);
+
+	return 0;
+}
+
+int uthread_ctx_init_entry(uthread_ctx_t *uctx, void *top_of_stack,
+			   void (*entry)(void))
+{
+	if (getcontext(uctx))
+		return -1;
+
+	uctx->uc_stack.ss_sp = top_of_stack;
+	uctx->uc_stack.ss_size = UTHREAD_STACK_SIZE;
+	uctx->uc_link = NULL;
+	makecontext(uctx, entry, 0);
+
+	return 0;
+}
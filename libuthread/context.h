@@ -39,6 +39,35 @@ void *uthread_ctx_alloc_stack(void);
  */
 void uthread_ctx_destroy_stack(void *top_of_stack);
 
+/*
+ * uthread_ctx_paint_stacks - Enable or disable stack painting
+ * @enable: Non-zero to paint the stacks allocated from now on, 0 to stop
+ *
+ * Painted stacks are filled with a known pattern when allocated, so that
+ * uthread_ctx_stack_used() can later find out how much of them was used.
+ */
+void uthread_ctx_paint_stacks(int enable);
+
+/*
+ * uthread_ctx_stack_used - Measure the high-water mark of a stack
+ * @top_of_stack: Stack segment, which must not be in use
+ *
+ * The part of the stack found used is painted again, so the stack can be
+ * reused and measured anew. A stack allocated while painting was disabled is
+ * painted now if painting is enabled, and can be measured next time.
+ *
+ * Return: Number of bytes of @top_of_stack used at its deepest, or -1 if the
+ * stack was not painted
+ */
+long uthread_ctx_stack_used(void *top_of_stack);
+
+/*
+ * uthread_ctx_stack_size - Get the size of stack segments
+ *
+ * Return: Size in bytes of the stack segments allocated for threads
+ */
+long uthread_ctx_stack_size(void);
+
 /*
  * uthread_ctx_init - Initialize a thread's execution context
  * @uctx: Pointer to thread context to initialize
@@ -52,4 +81,36 @@ void uthread_ctx_destroy_stack(void *top_of_stack);
 int uthread_ctx_init(uthread_ctx_t *uctx, void *top_of_stack,
 		     uthread_func_t func, void *arg);
 
+/*
+ * uthread_ctx_init_from_template - Initialize a context without getcontext()
+ * @uctx: Pointer to thread context to initialize
+ * @top_of_stack: Pointer to the top of a valid stack segment, as allocated by
+ *	uthread_ctx_alloc_stack()
+ * @func: Function to be executed by the thread
+ * @arg: Argument to pass to the thread
+ *
+ * Same as uthread_ctx_init(), but the context is copied from a template
+ * captured once, which is cheaper when creating many threads.
+ *
+ * Return: 0 if @uctx was properly initialized, or -1 in case of failure
+ */
+int uthread_ctx_init_from_template(uthread_ctx_t *uctx, void *top_of_stack,
+				   uthread_func_t func, void *arg);
+
+/*
+ * uthread_ctx_init_entry - Initialize a context running a plain function
+ * @uctx: Pointer to context to initialize
+ * @top_of_stack: Pointer to the top of a valid stack segment, as allocated by
+ *	uthread_ctx_alloc_stack()
+ * @entry: Function executed when the context is first switched to
+ *
+ * Unlike thread contexts, the context does not go through the thread
+ * bootstrap: @entry runs as is and must switch away for good rather than
+ * return.
+ *
+ * Return: 0 if @uctx was properly initialized, or -1 in case of failure
+ */
+int uthread_ctx_init_entry(uthread_ctx_t *uctx, void *top_of_stack,
+			   void (*entry)(void));
+
 #endif /* _CONTEXT_H */
@@ -0,0 +1,56 @@
+#include <stdint.h>
+#include <time.h>
+
+#include "cycles.h"
+
+/* Minimum interval over which the counter frequency is measured (in ns) */
+#define CALIBRATION_NS 1000000
+
+/* Counter frequency, calibrated at first use */
+static double ns_per_cycle;
+
+/*
+ * monotonic_ns - Read the monotonic clock
+ *
+ * Return: Current time in nanoseconds
+ */
+static uint64_t monotonic_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/*
+ * cycles_calibrate - Measure the frequency of the counter
+ */
+static void cycles_calibrate(void)
+{
+	uint64_t start_cycles, start_ns, end_cycles, end_ns;
+
+	start_cycles = cycles_now();
+	start_ns = monotonic_ns();
+	do {
+		end_cycles = cycles_now();
+		end_ns = monotonic_ns();
+	} while (end_ns - start_ns < CALIBRATION_NS);
+
+	ns_per_cycle = (double)(end_ns - start_ns) / (end_cycles - start_cycles);
+}
+
+uint64_t cycles_to_ns(uint64_t cycles)
+{
+	if (!ns_per_cycle)
+		cycles_calibrate();
+
+	return (uint64_t)(cycles * ns_per_cycle);
+}
+
+uint64_t ns_to_cycles(uint64_t ns)
+{
+	if (!ns_per_cycle)
+		cycles_calibrate();
+
+	return (uint64_t)(ns / ns_per_cycle);
+}
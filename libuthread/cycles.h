@@ -0,0 +1,58 @@
+#ifndef _CYCLES_H
+#define _CYCLES_H
+
+#include <stdint.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+ * cycles_now - Read the cheapest available cycle counter
+ *
+ * On x86 this is the time-stamp counter, on AArch64 the virtual counter. Other
+ * architectures fall back to the monotonic clock in nanoseconds. Values are
+ * only meaningful relative to each other; use cycles_to_ns() to convert them.
+ *
+ * Return: Current value of the counter
+ */
+static inline uint64_t cycles_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#elif defined(__aarch64__)
+	uint64_t val;
+
+	__asm__ __volatile__("mrs %0, cntvct_el0" : "=r" (val));
+	return val;
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+/*
+ * cycles_to_ns - Convert a number of cycles to nanoseconds
+ * @cycles: Number of cycles
+ *
+ * The frequency of the counter is calibrated against the monotonic clock the
+ * first time this function is called, which takes about a millisecond.
+ *
+ * Return: Duration of @cycles in nanoseconds
+ */
+uint64_t cycles_to_ns(uint64_t cycles);
+
+/*
+ * ns_to_cycles - Convert nanoseconds to a number of cycles
+ * @ns: Duration in nanoseconds
+ *
+ * Same calibration as cycles_to_ns().
+ *
+ * Return: Number of cycles elapsing in @ns nanoseconds
+ */
+uint64_t ns_to_cycles(uint64_t ns);
+
+#endif /* _CYCLES_H */
@@ -0,0 +1,54 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "hist.h"
+
+void hist_reset(struct hist *h)
+{
+	memset(h, 0, sizeof(*h));
+}
+
+/*
+ * hist_bucket_max - Get the largest value of a bucket
+ * @bucket: Index of the bucket
+ */
+static uint64_t hist_bucket_max(unsigned int bucket)
+{
+	unsigned int shift;
+	uint64_t first;
+
+	if (bucket < HIST_SUB_BUCKETS)
+		return bucket;
+
+	/* Inverse of hist_bucket(): smallest value of the next bucket, minus 1 */
+	shift = (bucket >> HIST_SUB_BITS) - 1;
+	first = (uint64_t)((bucket & (HIST_SUB_BUCKETS - 1)) + HIST_SUB_BUCKETS);
+	return ((first + 1) << shift) - 1;
+}
+
+uint64_t hist_percentile(const struct hist *h, double percentile)
+{
+	uint64_t rank, seen = 0;
+	unsigned int i;
+
+	if (!h->count)
+		return 0;
+
+	/* Rank of the value to find, counting from 1 */
+	rank = (uint64_t)(percentile / 100.0 * h->count + 0.5);
+	if (rank < 1)
+		rank = 1;
+	if (rank > h->count)
+		rank = h->count;
+
+	for (i = 0; i < HIST_BUCKETS; i++) {
+		seen += h->buckets[i];
+		if (seen >= rank) {
+			uint64_t max = hist_bucket_max(i);
+
+			return max < h->max ? max : h->max;
+		}
+	}
+
+	return h->max;
+}
@@ -0,0 +1,80 @@
+#ifndef _HIST_H
+#define _HIST_H
+
+#include <stdint.h>
+
+/*
+ * struct hist - Log-linear histogram
+ *
+ * Values are grouped in buckets whose width doubles with every power of 2, each
+ * power of 2 being split in HIST_SUB_BUCKETS linear sub-buckets (like an HDR
+ * histogram). Values below HIST_SUB_BUCKETS are recorded exactly and larger
+ * values with a relative error below 1 / HIST_SUB_BUCKETS.
+ *
+ * Recording a value is a couple of shifts and an increment, so a histogram can
+ * be kept up to date on hot paths.
+ */
+#define HIST_SUB_BITS		5
+#define HIST_SUB_BUCKETS	(1 << HIST_SUB_BITS)
+#define HIST_BUCKETS		((64 - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS)
+
+struct hist {
+	uint64_t count;			/* number of recorded values */
+	uint64_t sum;			/* sum of the recorded values */
+	uint64_t min;			/* smallest recorded value */
+	uint64_t max;			/* largest recorded value */
+	uint64_t buckets[HIST_BUCKETS];	/* number of values per bucket */
+};
+
+/*
+ * hist_reset - Empty a histogram
+ * @h: Histogram to reset
+ */
+void hist_reset(struct hist *h);
+
+/*
+ * hist_bucket - Get the bucket of a value
+ * @value: Value to classify
+ *
+ * Return: Index of the bucket of @value
+ */
+static inline unsigned int hist_bucket(uint64_t value)
+{
+	unsigned int shift;
+
+	if (value < HIST_SUB_BUCKETS)
+		return value;
+
+	/* Keep the HIST_SUB_BITS + 1 most significant bits of @value */
+	shift = 63 - __builtin_clzll(value) - HIST_SUB_BITS;
+	return ((shift + 1) << HIST_SUB_BITS) +
+		(value >> shift) - HIST_SUB_BUCKETS;
+}
+
+/*
+ * hist_record - Record a value
+ * @h: Histogram in which to record
+ * @value: Value to record
+ */
+static inline void hist_record(struct hist *h, uint64_t value)
+{
+	if (!h->count || value < h->min)
+		h->min = value;
+	if (value > h->max)
+		h->max = value;
+	h->count++;
+	h->sum += value;
+	h->buckets[hist_bucket(value)]++;
+}
+
+/*
+ * hist_percentile - Get a percentile of the recorded values
+ * @h: Histogram to query
+ * @percentile: Percentile to compute, between 0 and 100
+ *
+ * Return: Upper bound of the bucket containing the @percentile-th value
+ * (capped to the largest recorded value), or 0 if @h is empty
+ */
+uint64_t hist_percentile(const struct hist *h, double percentile);
+
+#endif /* _HIST_H */
@@ -0,0 +1,214 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stddef.h>
+#include <unistd.h>
+
+#include "offload.h"
+#include "preempt.h"
+#include "uthread.h"
+
+/* number of helper kernel threads */
+#define OFFLOAD_THREADS 4
+
+/* a call waiting for or running on a helper, on the stack of its caller */
+struct offload_job
+{
+    uthread_offload_func_t func;    /* function to run */
+    void *arg;                      /* argument passed to func */
+    long result;                    /* return value of func */
+    int error;                      /* errno set by func */
+    int done;                       /* set once func returned */
+    uthread_sched_t sched;          /* scheduler of the caller */
+    struct offload_job *next;       /* next job in the queue */
+};
+
+/* jobs waiting for a helper, shared by all the schedulers */
+static pthread_mutex_t jobs_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobs_pending = PTHREAD_COND_INITIALIZER;
+static struct offload_job *jobs_head = NULL;
+static struct offload_job *jobs_tail = NULL;
+
+/* helpers are started by the first call */
+static pthread_once_t helpers_once = PTHREAD_ONCE_INIT;
+static int helpers_started = 0;
+
+/*
+ * helper - Run offloaded jobs
+ * @unused: unused
+ *
+ * Completions are posted to the scheduler of the caller, which wakes it up at
+ * its next scheduling point.
+ */
+static void *helper(void *unused)
+{
+    struct offload_job *job;
+    uthread_sched_t sched;
+    int *done;
+
+    while(1)
+    {
+        pthread_mutex_lock(&jobs_lock);
+        while(!jobs_head)
+            pthread_cond_wait(&jobs_pending, &jobs_lock);
+        job = jobs_head;
+        jobs_head = job->next;
+        if(!jobs_head)
+            jobs_tail = NULL;
+        pthread_mutex_unlock(&jobs_lock);
+
+        errno = 0;
+        job->result = job->func(job->arg);
+        job->error = errno;
+
+        /* the caller may return as soon as done is set, the job is not
+         * touched afterwards: the request holds its own copy of the address,
+         * which is only compared with the ones threads park on. Served late,
+         * it can at most wake up a thread parked there since, spuriously
+         */
+        sched = job->sched;
+        done = &job->done;
+        __atomic_store_n(&job->done, 1, __ATOMIC_RELEASE);
+
+        /* the caller never wakes up without the request, try until it is sent */
+        while(uthread_unpark_remote(sched, done, 1))
+            sched_yield();
+    }
+
+    return NULL;
+}
+
+/*
+ * helpers_start - Start the helper kernel threads
+ */
+static void helpers_start(void)
+{
+    sigset_t all, old;
+    pthread_t thread;
+    int i;
+
+    /* helpers inherit the signal mask, keep the preemption ticks away */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    for(i = 0; i < OFFLOAD_THREADS; i++)
+    {
+        if(pthread_create(&thread, NULL, helper, NULL) == 0)
+        {
+            pthread_detach(thread);
+            helpers_started++;
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+}
+
+long uthread_offload(uthread_offload_func_t func, void *arg)
+{
+    struct offload_job job = { .func = func, .arg = arg };
+
+    /* another thread of the scheduler must not wait on the once control */
+    preempt_disable();
+    pthread_once(&helpers_once, helpers_start);
+    preempt_enable();
+
+    /* without helpers, or any other thread to stall, run the call here */
+    job.sched = uthread_sched_self();
+    if(!helpers_started || !job.sched)
+        return func(arg);
+
+    /* a thread preempted while holding the lock would deadlock the next
+     * thread of the scheduler taking it
+     */
+    preempt_disable();
+    pthread_mutex_lock(&jobs_lock);
+    if(jobs_tail)
+        jobs_tail->next = &job;
+    else
+        jobs_head = &job;
+    jobs_tail = &job;
+    pthread_cond_signal(&jobs_pending);
+    pthread_mutex_unlock(&jobs_lock);
+    preempt_enable();
+
+    while(!__atomic_load_n(&job.done, __ATOMIC_ACQUIRE))
+        uthread_park_remote(&job.done, 0);
+
+    errno = job.error;
+    return job.result;
+}
+
+/* arguments of the offloaded file-system calls */
+struct open_args
+{
+    const char *path;
+    int flags;
+    mode_t mode;
+};
+
+struct stat_args
+{
+    const char *path;
+    struct stat *buf;
+};
+
+struct getaddrinfo_args
+{
+    const char *node;
+    const char *service;
+    const struct addrinfo *hints;
+    struct addrinfo **res;
+};
+
+static long offload_open(void *arg)
+{
+    struct open_args *a = arg;
+
+    return open(a->path, a->flags, a->mode);
+}
+
+static long offload_stat(void *arg)
+{
+    struct stat_args *a = arg;
+
+    return stat(a->path, a->buf);
+}
+
+static long offload_fsync(void *arg)
+{
+    return fsync(*(int*)arg);
+}
+
+static long offload_getaddrinfo(void *arg)
+{
+    struct getaddrinfo_args *a = arg;
+
+    return getaddrinfo(a->node, a->service, a->hints, a->res);
+}
+
+int uthread_open(const char *path, int flags, mode_t mode)
+{
+    struct open_args a = { path, flags, mode };
+
+    return uthread_offload(offload_open, &a);
+}
+
+int uthread_stat(const char *path, struct stat *buf)
+{
+    struct stat_args a = { path, buf };
+
+    return uthread_offload(offload_stat, &a);
+}
+
+int uthread_fsync(int fd)
+{
+    return uthread_offload(offload_fsync, &fd);
+}
+
+int uthread_getaddrinfo(const char *node, const char *service,
+	const struct addrinfo *hints, struct addrinfo **res)
+{
+    struct getaddrinfo_args a = { node, service, hints, res };
+
+    return uthread_offload(offload_getaddrinfo, &a);
+}
@@ -0,0 +1,79 @@
+#ifndef _OFFLOAD_H
+#define _OFFLOAD_H
+
+#include <netdb.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "uthread.h"
+
+/*
+ * uthread_offload_func_t - Offloaded function type
+ * @arg: Argument to be passed to the function
+ *
+ * Return: Long value, handed back to the caller of uthread_offload()
+ */
+typedef long (*uthread_offload_func_t)(void *arg);
+
+/*
+ * uthread_offload - Run a blocking call on a helper kernel thread
+ * @func: Function to run
+ * @arg: Argument to be passed to @func
+ *
+ * All the threads of a scheduler share one kernel thread, so a call which
+ * blocks in the kernel (and has no non-blocking form) stalls all of them. This
+ * function runs @func on a small pool of helper kernel threads, started on
+ * first use, while the calling thread is parked and the other threads keep
+ * running. The helper posts the completion back to the scheduler, which wakes
+ * the caller up.
+ *
+ * @func runs outside of the library: it must not call any uthread function
+ * other than uthread_submit() and uthread_unpark_remote(). The value of errno
+ * set by @func is carried back to the caller.
+ *
+ * If the helpers cannot be started, @func is run by the calling thread.
+ *
+ * Return: The return value of @func
+ */
+long uthread_offload(uthread_offload_func_t func, void *arg);
+
+/*
+ * uthread_open - Offloaded open()
+ * @path: Path of the file
+ * @flags: Access mode and file creation flags
+ * @mode: Permissions of a created file
+ *
+ * Return: Like open()
+ */
+int uthread_open(const char *path, int flags, mode_t mode);
+
+/*
+ * uthread_stat - Offloaded stat()
+ * @path: Path of the file
+ * @buf: Structure receiving the status of the file
+ *
+ * Return: Like stat()
+ */
+int uthread_stat(const char *path, struct stat *buf);
+
+/*
+ * uthread_fsync - Offloaded fsync()
+ * @fd: File descriptor to flush
+ *
+ * Return: Like fsync()
+ */
+int uthread_fsync(int fd);
+
+/*
+ * uthread_getaddrinfo - Offloaded getaddrinfo()
+ * @node: Host name or address
+ * @service: Service name or port number
+ * @hints: (Optional) Criteria for the returned addresses
+ * @res: Address of a pointer receiving the list of addresses
+ *
+ * Return: Like getaddrinfo()
+ */
+int uthread_getaddrinfo(const char *node, const char *service,
+	const struct addrinfo *hints, struct addrinfo **res);
+
+#endif /* _OFFLOAD_H */
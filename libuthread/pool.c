@@ -0,0 +1,353 @@
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "cycles.h"
+#include "pool.h"
+#include "preempt.h"
+#include "uthread.h"
+
+/* success and failure defines */
+#define SUCCESS 0
+#define FAILURE -1
+
+/* state of a worker slot */
+enum
+{
+    SLOT_FREE,      /* no worker, or its thread was collected */
+    SLOT_ACTIVE,    /* worker running, ready or parked */
+    SLOT_RETIRED    /* worker exited (or exiting), not collected yet */
+};
+
+/* a submitted task, waiting in the pool queue or kept for reuse */
+struct pool_task
+{
+    uthread_func_t func;            /* function to execute */
+    void *arg;                      /* argument passed to func */
+    uthread_future_t *future;       /* future to complete (or NULL) */
+    struct pool_task *next;         /* next task in the queue or free list */
+};
+
+/* a worker thread of the pool */
+struct pool_slot
+{
+    struct uthread_pool *pool;      /* the pool the worker belongs to */
+    uthread_t tid;                  /* TID of the worker thread */
+    int state;                      /* free, active or retired */
+};
+
+/* a worker pool */
+struct uthread_pool
+{
+    struct pool_task *head;         /* oldest queued task */
+    struct pool_task *tail;         /* newest queued task */
+    struct pool_task *free_tasks;   /* tasks kept for reuse */
+    int submitted;                  /* bumped at every submission, workers park on it */
+    int workers;                    /* number of active workers */
+    int idle;                       /* number of parked workers, counted by the workers themselves */
+    int waking;                     /* wake ups sent to parked workers, not consumed yet */
+    int retire;                     /* number of workers asked to exit */
+    int closing;                    /* the pool is being destroyed */
+    uint64_t idle_since;            /* cycle count when a worker last went idle with none idle */
+    uint64_t idle_ns;               /* idle time after which extra workers are retired */
+    int min_workers;                /* minimum number of workers */
+    int max_workers;                /* maximum number of workers (number of slots) */
+    struct pool_slot slots[];       /* the workers */
+};
+
+/*
+ * pool_bump - Signal parked workers that something changed
+ * @pool: the pool
+ *
+ * Workers park on the submission counter, so changing it makes a worker about
+ * to park see there is something to do. Must be called with preemption
+ * disabled.
+ */
+static void pool_bump(struct uthread_pool *pool)
+{
+    pool->submitted = pool->submitted == INT_MAX ? 0 : pool->submitted + 1;
+}
+
+/*
+ * pool_worker - Main function of the worker threads
+ * @arg: the slot of the worker
+ *
+ * Run queued tasks in order, and park when there is none.
+ */
+static int pool_worker(void *arg)
+{
+    struct pool_slot *slot = arg;
+    struct uthread_pool *pool = slot->pool;
+    struct pool_task *task;
+    uthread_future_t *future;
+    int submitted, parked, retval;
+
+    while(1)
+    {
+        /* disable preemption
+         * make sure a task is only picked by one worker
+         */
+        preempt_disable();
+
+        /* the pool shrinks, whichever worker gets there first exits */
+        if(pool->retire > 0)
+        {
+            pool->retire--;
+            break;
+        }
+
+        task = pool->head;
+        if(task)
+        {
+            pool->head = task->next;
+            if(!pool->head)
+                pool->tail = NULL;
+            preempt_enable();
+
+            retval = task->func(task->arg);
+
+            /* keep the task for reuse and report completion */
+            preempt_disable();
+            future = task->future;
+            task->next = pool->free_tasks;
+            pool->free_tasks = task;
+            preempt_enable();
+
+            if(future)
+                uthread_future_complete(future, (void*)(intptr_t)retval, 0);
+            continue;
+        }
+
+        /* no task left */
+        if(pool->closing)
+            break;
+
+        if(pool->idle++ == 0)
+            pool->idle_since = cycles_now();
+        submitted = pool->submitted;
+
+        /* re-enable preemption before parking, which disables it itself */
+        preempt_enable();
+
+        /* parking fails right away if something was submitted in between */
+        parked = uthread_park(&pool->submitted, submitted);
+
+        /* woken up or not, the worker is not idle anymore: submissions only
+         * guess which worker their wake up reaches, so the worker accounts
+         * for itself, consuming one of the wake ups sent
+         */
+        preempt_disable();
+        pool->idle--;
+        if(pool->waking > 0)
+            pool->waking--;
+
+        /* no other thread could run, nothing will ever be submitted */
+        if(parked == FAILURE && pool->submitted == submitted)
+        {
+            pool->workers--;
+            break;
+        }
+        preempt_enable();
+    }
+
+    slot->state = SLOT_RETIRED;
+    preempt_enable();
+
+    return 0;
+}
+
+/*
+ * pool_start_worker - Start a worker in a slot
+ * @pool: the pool
+ * @slot: a free or retired slot, already accounted in the number of workers
+ *
+ * The previous worker of the slot is collected if needed.
+ *
+ * Return: -1 if the worker thread cannot be created, 0 otherwise
+ */
+static int pool_start_worker(struct uthread_pool *pool, struct pool_slot *slot)
+{
+    int tid;
+
+    if(slot->state == SLOT_RETIRED)
+        uthread_join(slot->tid, NULL);
+
+    slot->pool = pool;
+    slot->state = SLOT_ACTIVE;
+    tid = uthread_create(pool_worker, slot);
+    if(tid == FAILURE)
+    {
+        preempt_disable();
+        slot->state = SLOT_FREE;
+        pool->workers--;
+        preempt_enable();
+        return FAILURE;
+    }
+    slot->tid = tid;
+
+    return SUCCESS;
+}
+
+uthread_pool_t uthread_pool_create(int min_workers, int max_workers,
+    unsigned long long idle_ns)
+{
+    struct uthread_pool *pool;
+    int i;
+
+    if(min_workers <= 0 || max_workers < min_workers)
+        return NULL;
+
+    pool = calloc(1, sizeof(*pool) + max_workers * sizeof(pool->slots[0]));
+    if(!pool)
+        return NULL;
+
+    pool->idle_ns = idle_ns;
+    pool->min_workers = min_workers;
+    pool->max_workers = max_workers;
+
+    for(i = 0; i < min_workers; i++)
+    {
+        pool->workers++;
+        if(pool_start_worker(pool, &pool->slots[i]) == FAILURE)
+        {
+            uthread_pool_destroy(pool);
+            return NULL;
+        }
+    }
+
+    return pool;
+}
+
+int uthread_pool_destroy(uthread_pool_t pool)
+{
+    struct pool_task *task;
+    int i;
+
+    if(!pool)
+        return FAILURE;
+
+    /* workers exit once the queue is drained */
+    preempt_disable();
+    pool->closing = 1;
+    pool_bump(pool);
+    preempt_enable();
+    uthread_unpark(&pool->submitted, INT_MAX);
+
+    for(i = 0; i < pool->max_workers; i++)
+        if(pool->slots[i].state != SLOT_FREE)
+            uthread_join(pool->slots[i].tid, NULL);
+
+    while(pool->free_tasks)
+    {
+        task = pool->free_tasks;
+        pool->free_tasks = task->next;
+        free(task);
+    }
+    free(pool);
+
+    return SUCCESS;
+}
+
+int uthread_pool_submit(uthread_pool_t pool, uthread_func_t func, void *arg,
+    uthread_future_t *future)
+{
+    struct pool_task *task;
+    struct pool_slot *slot = NULL;
+    int wake = 0, i;
+
+    if(!pool || !func)
+        return FAILURE;
+
+    if(future)
+        uthread_future_init(future);
+
+    /* disable preemption
+     * make sure the queue and the worker counts stay consistent
+     */
+    preempt_disable();
+
+    task = pool->free_tasks;
+    if(task)
+        pool->free_tasks = task->next;
+    else if(!(task = malloc(sizeof(*task))))
+    {
+        preempt_enable();
+        return FAILURE;
+    }
+
+    task->func = func;
+    task->arg = arg;
+    task->future = future;
+    task->next = NULL;
+    if(pool->tail)
+        pool->tail->next = task;
+    else
+        pool->head = task;
+    pool->tail = task;
+    pool_bump(pool);
+
+    /* a worker stayed idle long enough, it is not needed */
+    if(pool->workers > pool->min_workers && pool->idle > pool->waking &&
+        cycles_to_ns(cycles_now() - pool->idle_since) >= pool->idle_ns)
+    {
+        pool->retire++;
+        pool->workers--;
+        pool->waking++;
+        pool->idle_since = cycles_now();
+        wake++;
+    }
+
+    if(pool->idle > pool->waking)
+    {
+        /* an idle worker picks the task */
+        pool->waking++;
+        wake++;
+    }
+    else if(pool->workers < pool->max_workers)
+    {
+        /* every worker is busy, a worker about to retire keeps its slot and
+         * picks the task instead of exiting
+         */
+        pool->workers++;
+        if(pool->retire > 0)
+            pool->retire--;
+        else
+        {
+            /* start a new one, the slots of the others are taken */
+            for(i = 0; pool->slots[i].state == SLOT_ACTIVE; i++)
+                ;
+            slot = &pool->slots[i];
+        }
+    }
+
+    /* re-enable preemption before waking up or creating threads */
+    preempt_enable();
+
+    if(wake)
+        uthread_unpark(&pool->submitted, wake);
+    if(slot)
+        pool_start_worker(pool, slot);
+
+    return SUCCESS;
+}
+
+int uthread_pool_wait(uthread_future_t *future, int *retval)
+{
+    void *value;
+
+    if(uthread_await(future, &value, NULL) == FAILURE)
+        return FAILURE;
+
+    if(retval)
+        *retval = (int)(intptr_t)value;
+
+    return SUCCESS;
+}
+
+int uthread_pool_size(uthread_pool_t pool)
+{
+    if(!pool)
+        return FAILURE;
+
+    return pool->workers;
+}
@@ -0,0 +1,88 @@
+#ifndef _POOL_H
+#define _POOL_H
+
+#include "uthread.h"
+
+/*
+ * uthread_pool_t - Worker pool type
+ *
+ * A worker pool runs submitted functions on a set of long-lived threads, which
+ * avoids creating and joining a thread (and setting up its stack and context)
+ * for every short task. Idle workers are parked until work is submitted.
+ *
+ * The pool keeps at least a minimum number of workers and grows on demand up
+ * to a maximum. Workers above the minimum which stay idle for a while are
+ * retired.
+ */
+typedef struct uthread_pool* uthread_pool_t;
+
+/*
+ * uthread_pool_create - Create a worker pool
+ * @min_workers: Number of workers started right away and always kept
+ * @max_workers: Maximum number of workers
+ * @idle_ns: Time after which an idle worker above @min_workers is retired
+ *
+ * Retirement is lazy: idle workers are retired one at a time, by submissions
+ * happening after a worker stayed idle for @idle_ns.
+ *
+ * Return: Pointer to the new pool. NULL if @min_workers is not positive, if
+ * @max_workers is less than @min_workers, or in case of failure when creating
+ * the pool or its workers.
+ */
+uthread_pool_t uthread_pool_create(int min_workers, int max_workers,
+				   unsigned long long idle_ns);
+
+/*
+ * uthread_pool_destroy - Destroy a worker pool
+ * @pool: Pool to destroy
+ *
+ * Wait for every task submitted to @pool to complete, then stop and collect
+ * the workers and free the pool. Must not be called from a task of @pool.
+ *
+ * Return: -1 if @pool is NULL. 0 otherwise.
+ */
+int uthread_pool_destroy(uthread_pool_t pool);
+
+/*
+ * uthread_pool_submit - Submit a task to a worker pool
+ * @pool: Pool to run the task
+ * @func: Function to be executed
+ * @arg: Argument to be passed to @func
+ * @future: (Optional) Future completed by the task
+ *
+ * Queue @func for execution by a worker of @pool, in submission order. An idle
+ * worker is woken up if there is one, otherwise a new worker is started if the
+ * pool has not reached its maximum size.
+ *
+ * @future is initialized here and must stay valid until the task completed. It
+ * is completed with the return value of @func carried in the value pointer
+ * itself (see uthread_pool_wait()), so any thread can also uthread_await() it.
+ *
+ * Return: -1 if @pool or @func are NULL, or in case of memory allocation
+ * failure. 0 otherwise.
+ */
+int uthread_pool_submit(uthread_pool_t pool, uthread_func_t func, void *arg,
+			uthread_future_t *future);
+
+/*
+ * uthread_pool_wait - Wait for a task to complete
+ * @future: Future of the task, as given to uthread_pool_submit()
+ * @retval: (Optional) Address of an integer receiving the return value
+ *
+ * Same as uthread_await(), with the return value of the task decoded from the
+ * result. Several threads can wait for the same future.
+ *
+ * Return: -1 if @future is NULL, in case of memory allocation failure, or if
+ * no other thread was left to run and complete the task. 0 otherwise.
+ */
+int uthread_pool_wait(uthread_future_t *future, int *retval);
+
+/*
+ * uthread_pool_size - Get the number of workers of a pool
+ * @pool: Pool to query
+ *
+ * Return: -1 if @pool is NULL. The number of workers of @pool otherwise.
+ */
+int uthread_pool_size(uthread_pool_t pool);
+
+#endif /* _POOL_H */
@@ -0,0 +1,292 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pqueue.h"
+
+#define FAILURE -1
+#define SUCCESS 0
+
+/* number of children of a heap node, 4 children share a cache line */
+#define PQUEUE_ARITY 4
+
+/* initial number of entries of a priority queue */
+#define PQUEUE_MIN_CAPACITY 16
+
+/* item of a priority queue, which is what handles point to */
+struct pqueue_node
+{
+    void *data;                     /* the adress of the data */
+    unsigned int index;             /* index of the entry of the item in the heap */
+    struct pqueue_node *next;       /* next free node when unused */
+};
+
+/*
+ * entry of the heap
+ *
+ * Keys are stored in the heap itself so that comparisons never need to follow
+ * the pointer to the node.
+ */
+struct pqueue_entry
+{
+    uint64_t key;                   /* key of the item */
+    uint64_t seq;                   /* push order, to break ties between equal keys */
+    struct pqueue_node *node;       /* the item */
+};
+
+/* a priority queue data structure, as an implicit d-ary min-heap */
+struct pqueue
+{
+    struct pqueue_entry *entries;   /* the heap, smallest key at index 0 */
+    unsigned int capacity;          /* number of allocated entries */
+    int length;                     /* the size of the priority queue */
+    uint64_t seq;                   /* number of items pushed so far */
+    struct pqueue_node *free_nodes; /* nodes kept for reuse */
+};
+
+/*
+ * entry_less - Compare two heap entries
+ * @a: first entry
+ * @b: second entry
+ *
+ * Return: 1 if @a must be popped before @b, 0 otherwise
+ */
+static inline int entry_less(const struct pqueue_entry *a,
+    const struct pqueue_entry *b)
+{
+    return a->key < b->key || (a->key == b->key && a->seq < b->seq);
+}
+
+/*
+ * entry_place - Store an entry in the heap
+ * @pqueue: the priority queue
+ * @i: index where to store the entry
+ * @entry: the entry
+ */
+static inline void entry_place(pqueue_t pqueue, unsigned int i,
+    const struct pqueue_entry *entry)
+{
+    pqueue->entries[i] = *entry;
+    entry->node->index = i;
+}
+
+/*
+ * sift_up - Move an entry towards the root until the heap is ordered
+ * @pqueue: the priority queue
+ * @i: index of the entry
+ */
+static void sift_up(pqueue_t pqueue, unsigned int i)
+{
+    struct pqueue_entry entry = pqueue->entries[i];
+
+    while(i > 0)
+    {
+        unsigned int parent = (i - 1) / PQUEUE_ARITY;
+
+        if(!entry_less(&entry, &pqueue->entries[parent]))
+            break;
+        entry_place(pqueue, i, &pqueue->entries[parent]);
+        i = parent;
+    }
+    entry_place(pqueue, i, &entry);
+}
+
+/*
+ * sift_down - Move an entry towards the leaves until the heap is ordered
+ * @pqueue: the priority queue
+ * @i: index of the entry
+ */
+static void sift_down(pqueue_t pqueue, unsigned int i)
+{
+    struct pqueue_entry entry = pqueue->entries[i];
+    unsigned int length = pqueue->length;
+
+    while(1)
+    {
+        unsigned int first = i * PQUEUE_ARITY + 1, last, child, j;
+
+        /* no children */
+        if(first >= length)
+            break;
+
+        /* find the smallest child */
+        last = first + PQUEUE_ARITY < length ? first + PQUEUE_ARITY : length;
+        child = first;
+        for(j = first + 1; j < last; j++)
+            if(entry_less(&pqueue->entries[j], &pqueue->entries[child]))
+                child = j;
+
+        if(!entry_less(&pqueue->entries[child], &entry))
+            break;
+        entry_place(pqueue, i, &pqueue->entries[child]);
+        i = child;
+    }
+    entry_place(pqueue, i, &entry);
+}
+
+pqueue_t pqueue_create(void)
+{
+    /* allocate memory for the priority queue */
+    pqueue_t pqueue = (pqueue_t) malloc(sizeof(struct pqueue));
+
+    /* failure of allocating new memory for a priority queue */
+    if(!pqueue)
+        return pqueue;
+
+    /* allocate the initial entries */
+    pqueue->entries = (struct pqueue_entry*)
+        malloc(PQUEUE_MIN_CAPACITY * sizeof(struct pqueue_entry));
+    if(!pqueue->entries)
+    {
+        free(pqueue);
+        return NULL;
+    }
+
+    /* initialize priority queue as empty */
+    pqueue->capacity = PQUEUE_MIN_CAPACITY;
+    pqueue->length = 0;
+    pqueue->seq = 0;
+    pqueue->free_nodes = NULL;
+    return pqueue;
+}
+
+int pqueue_destroy(pqueue_t pqueue)
+{
+    /* priority queue is NULL or not empty */
+    if(!pqueue || pqueue->length)
+        return FAILURE;
+
+    /* free the nodes kept for reuse */
+    while(pqueue->free_nodes)
+    {
+        struct pqueue_node *next = pqueue->free_nodes->next;
+
+        free(pqueue->free_nodes);
+        pqueue->free_nodes = next;
+    }
+
+    free(pqueue->entries);
+    free(pqueue);
+    return SUCCESS;
+}
+
+int pqueue_push(pqueue_t pqueue, uint64_t key, void *data,
+    pqueue_handle_t *handle)
+{
+    struct pqueue_entry entry;
+    struct pqueue_node *node;
+
+    /* priority queue is NULL or data is NULL */
+    if(!pqueue || !data)
+        return FAILURE;
+
+    /* double the heap when full */
+    if((unsigned int)pqueue->length == pqueue->capacity)
+    {
+        struct pqueue_entry *entries = (struct pqueue_entry*) realloc(
+            pqueue->entries, 2 * pqueue->capacity * sizeof(struct pqueue_entry));
+
+        if(!entries)
+            return FAILURE;
+        pqueue->entries = entries;
+        pqueue->capacity *= 2;
+    }
+
+    /* reuse a node if possible */
+    node = pqueue->free_nodes;
+    if(node)
+        pqueue->free_nodes = node->next;
+    else
+    {
+        node = (struct pqueue_node*) malloc(sizeof(struct pqueue_node));
+        if(!node)
+            return FAILURE;
+    }
+    node->data = data;
+
+    /* insert as the last leaf, then restore the heap order */
+    entry.key = key;
+    entry.seq = pqueue->seq++;
+    entry.node = node;
+    entry_place(pqueue, pqueue->length++, &entry);
+    sift_up(pqueue, pqueue->length - 1);
+
+    if(handle)
+        *handle = node;
+    return SUCCESS;
+}
+
+int pqueue_remove(pqueue_t pqueue, pqueue_handle_t handle)
+{
+    unsigned int i;
+
+    /* priority queue is NULL or handle is NULL */
+    if(!pqueue || !handle)
+        return FAILURE;
+
+    /* move the last leaf in place of the removed entry */
+    i = handle->index;
+    pqueue->length--;
+    if(i != (unsigned int)pqueue->length)
+    {
+        entry_place(pqueue, i, &pqueue->entries[pqueue->length]);
+
+        /* the moved entry can be smaller than the parent or larger than its children */
+        if(i > 0 && entry_less(&pqueue->entries[i],
+            &pqueue->entries[(i - 1) / PQUEUE_ARITY]))
+            sift_up(pqueue, i);
+        else
+            sift_down(pqueue, i);
+    }
+
+    /* keep the node for reuse */
+    handle->next = pqueue->free_nodes;
+    pqueue->free_nodes = handle;
+    return SUCCESS;
+}
+
+int pqueue_pop(pqueue_t pqueue, void **data, uint64_t *key)
+{
+    /* priority queue is NULL or data is NULL or queue is empty */
+    if(!pqueue || !data || !pqueue->length)
+        return FAILURE;
+
+    *data = pqueue->entries[0].node->data;
+    if(key)
+        *key = pqueue->entries[0].key;
+    return pqueue_remove(pqueue, pqueue->entries[0].node);
+}
+
+int pqueue_peek(pqueue_t pqueue, void **data, uint64_t *key)
+{
+    /* priority queue is NULL or queue is empty */
+    if(!pqueue || !pqueue->length)
+        return FAILURE;
+
+    if(data)
+        *data = pqueue->entries[0].node->data;
+    if(key)
+        *key = pqueue->entries[0].key;
+    return SUCCESS;
+}
+
+int pqueue_decrease_key(pqueue_t pqueue, pqueue_handle_t handle, uint64_t key)
+{
+    /* priority queue is NULL or handle is NULL */
+    if(!pqueue || !handle)
+        return FAILURE;
+
+    /* the key can only decrease */
+    if(key > pqueue->entries[handle->index].key)
+        return FAILURE;
+
+    pqueue->entries[handle->index].key = key;
+    sift_up(pqueue, handle->index);
+    return SUCCESS;
+}
+
+int pqueue_length(pqueue_t pqueue)
+{
+    /* -1 if priority queue is NULL, length of the priority queue otherwise */
+    return pqueue ? pqueue->length : FAILURE;
+}
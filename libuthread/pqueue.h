@@ -0,0 +1,106 @@
+#ifndef _PQUEUE_H
+#define _PQUEUE_H
+
+#include <stdint.h>
+
+/*
+ * pqueue_t - Priority queue type
+ *
+ * A priority queue holds data items associated to a key. When popping, the
+ * queue returns the item with the smallest key first. Items with equal keys
+ * are returned in the order they were pushed.
+ *
+ * Pushing, popping, decreasing a key and removing an item are O(log n), and
+ * peeking and getting the length are O(1).
+ */
+typedef struct pqueue* pqueue_t;
+
+/*
+ * pqueue_handle_t - Priority queue item handle type
+ *
+ * A handle designates one particular item of a priority queue, so that its key
+ * can be decreased or the item removed. A handle is valid from the moment its
+ * item is pushed until it leaves the queue (popped or removed).
+ */
+typedef struct pqueue_node* pqueue_handle_t;
+
+/*
+ * pqueue_create - Allocate an empty priority queue
+ *
+ * Return: Pointer to new empty priority queue. NULL in case of failure when
+ * allocating the new queue.
+ */
+pqueue_t pqueue_create(void);
+
+/*
+ * pqueue_destroy - Deallocate a priority queue
+ * @pqueue: Priority queue to deallocate
+ *
+ * Return: -1 if @pqueue is NULL or if @pqueue is not empty. 0 if @pqueue was
+ * successfully destroyed.
+ */
+int pqueue_destroy(pqueue_t pqueue);
+
+/*
+ * pqueue_push - Push data item
+ * @pqueue: Priority queue in which to push item
+ * @key: Key of the item
+ * @data: Address of data item to push
+ * @handle: (Optional) Address of a handle receiving the handle of the item
+ *
+ * Return: -1 if @pqueue or @data are NULL, or in case of memory allocation
+ * error. 0 if @data was successfully pushed in @pqueue.
+ */
+int pqueue_push(pqueue_t pqueue, uint64_t key, void *data,
+		pqueue_handle_t *handle);
+
+/*
+ * pqueue_pop - Pop the item with the smallest key
+ * @pqueue: Priority queue in which to pop item
+ * @data: Address of data pointer where item is received
+ * @key: (Optional) Address of a key receiving the key of the item
+ *
+ * Return: -1 if @pqueue or @data are NULL, or if the queue is empty. 0 if
+ * @data was set with the item with the smallest key.
+ */
+int pqueue_pop(pqueue_t pqueue, void **data, uint64_t *key);
+
+/*
+ * pqueue_peek - Get the item with the smallest key without popping it
+ * @pqueue: Priority queue to look into
+ * @data: (Optional) Address of data pointer where item is received
+ * @key: (Optional) Address of a key receiving the key of the item
+ *
+ * Return: -1 if @pqueue is NULL or if the queue is empty. 0 otherwise.
+ */
+int pqueue_peek(pqueue_t pqueue, void **data, uint64_t *key);
+
+/*
+ * pqueue_decrease_key - Decrease the key of an item
+ * @pqueue: Priority queue containing the item
+ * @handle: Handle of the item
+ * @key: New key of the item
+ *
+ * Return: -1 if @pqueue or @handle are NULL, or if @key is larger than the
+ * current key of the item. 0 if the key of the item was changed.
+ */
+int pqueue_decrease_key(pqueue_t pqueue, pqueue_handle_t handle, uint64_t key);
+
+/*
+ * pqueue_remove - Remove an item
+ * @pqueue: Priority queue containing the item
+ * @handle: Handle of the item
+ *
+ * Return: -1 if @pqueue or @handle are NULL. 0 if the item was removed.
+ */
+int pqueue_remove(pqueue_t pqueue, pqueue_handle_t handle);
+
+/*
+ * pqueue_length - Priority queue length
+ * @pqueue: Priority queue to get the length of
+ *
+ * Return: -1 if @pqueue is NULL. Length of @pqueue otherwise.
+ */
+int pqueue_length(pqueue_t pqueue);
+
+#endif /* _PQUEUE_H */
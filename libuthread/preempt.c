@@ -1,19 +1,29 @@
+/* per-thread timer signals (SIGEV_THREAD_ID) */
+#define _GNU_SOURCE
+#include <pthread.h>
 #include <signal.h>
 #include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <sys/time.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "preempt.h"
 #include "uthread.h"
 
 /*
- * Frequency of preemption
- * 100Hz is 100 times per second
+ * Frequency of the preemption tick
+ * 1000Hz is 1000 times per second. The tick only checks whether the running
+ * thread used up its time slice, so it is finer than the slices themselves.
  */
-#define HZ 100
+#define HZ 1000
+
+static pthread_once_t handler_once = PTHREAD_ONCE_INIT; /* installs the handler once per process */
+static __thread timer_t timer;                /* the preemption timer of the calling kernel thread */
+static __thread int timer_armed = 0;          /* whether timer was created */
 
 /*
  * forceful_yield - forcefully yield to next thread
@@ -24,7 +34,7 @@
  */
 void forceful_yield (int signum)
 {
-    uthread_yield();
+    uthread_preempt_yield();
 }
 
 void preempt_disable(void)
@@ -49,22 +59,56 @@ void preempt_enable(void)
     sigprocmask(SIG_UNBLOCK, &alarm, NULL);
 }
 
+/*
+ * handler_install - Install the timer handler for the whole process
+ */
+static void handler_install(void)
+{
+    signal(SIGVTALRM, forceful_yield);
+}
+
 void preempt_start(void)
 {
-    struct itimerval timer;
+    struct sigevent event;
+    struct itimerspec spec;
 
     /* install the timer handler to forcefully yield */
-    signal(SIGVTALRM, forceful_yield);
-    
-    /* set up the time elapse to every 0.01s */
-    timer.it_value.tv_sec = 0;
-    timer.it_value.tv_usec = 1000000 / HZ;
+    pthread_once(&handler_once, handler_install);
+
+    /* the kernel thread may have run another scheduler before */
+    if(timer_armed)
+        return;
+
+    /* tick on the CPU time of this kernel thread, and signal this kernel
+     * thread only: every scheduler is preempted by its own timer
+     */
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGVTALRM;
+    event._sigev_un._tid = gettid();           /* sigev_notify_thread_id */
+    if(timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &timer))
+    {
+        perror("preempt_start");
+        return;
+    }
+
+    /* set up the time elapse to every 0.001s */
+    spec.it_value.tv_sec = 0;
+    spec.it_value.tv_nsec = 1000000000 / HZ;
 
     /* set up timer interval between two alarms */
-    timer.it_interval.tv_sec = 0;
-    timer.it_interval.tv_usec = 1;
+    spec.it_interval.tv_sec = 0;
+    spec.it_interval.tv_nsec = 1000000000 / HZ;
 
-    /* set up the virtual timer for process time */
-    setitimer(ITIMER_VIRTUAL, &timer, NULL);
+    timer_settime(timer, 0, &spec, NULL);
+    timer_armed = 1;
 }
 
+void preempt_stop(void)
+{
+    if(!timer_armed)
+        return;
+
+    timer_delete(timer);
+    timer_armed = 0;
+}
@@ -4,11 +4,21 @@
 /*
  * preempt_start - Start thread preemption
  *
- * Configure a timer that must fire a virtual alarm at a frequency of 100 Hz and
- * setup a timer handler that forcefully yields the currently running thread.
+ * Configure a timer that must fire a virtual alarm at a frequency of 1000 Hz and
+ * setup a timer handler that forcefully yields the currently running thread
+ * once its time slice is used up.
+ *
+ * The handler is installed once for the process, but every kernel thread
+ * calling this function gets a timer of its own, counting its CPU time and
+ * signaling it only.
  */
 void preempt_start(void);
 
+/*
+ * preempt_stop - Stop the preemption timer of the calling kernel thread
+ */
+void preempt_stop(void);
+
 /*
  * preempt_enable - Enable preemption
  */
@@ -19,4 +29,13 @@ void preempt_enable(void);
  */
 void preempt_disable(void);
 
+/*
+ * uthread_preempt_yield - Yield on behalf of the preemption timer
+ *
+ * Implemented by the scheduler and called from the timer handler instead of
+ * uthread_yield() so that forced switches can be told apart from voluntary
+ * ones. The running thread is only switched out if its time slice is used up.
+ */
+void uthread_preempt_yield(void);
+
 #endif /* _PREEMPT_H */
@@ -12,6 +12,7 @@ struct queue_node
 {
     void *data;                     /* the adress of the data */
     struct queue_node *next;        /* the next queue node */
+    struct queue_node *prev;        /* the previous queue node */
 };
 
 /* a queue data structure */
@@ -49,7 +50,7 @@ int queue_destroy(queue_t queue)
     return SUCCESS;
 }
 
-int queue_enqueue(queue_t queue, void *data)
+int queue_enqueue_handle(queue_t queue, void *data, queue_handle_t *handle)
 {
     /* queue is NULL or data is NULL */
     if(!queue || !data)
@@ -66,6 +67,7 @@ int queue_enqueue(queue_t queue, void *data)
     /* initialize new queue node */
     new_node->data = data;                              /* copy the data */
     new_node->next = NULL;                              /* initialize new node NULL */
+    new_node->prev = queue->tail;                       /* connect to the current tail */
     if(!(queue->head))                                  /* the queue is empty */
     {    
         queue->head = new_node;
@@ -78,9 +80,18 @@ int queue_enqueue(queue_t queue, void *data)
 	tail->next = new_node;                          /* connect previous tail */
     }
     queue->length++;                                    /* increment the queue size */ 
+
+    /* the node itself is the handle */
+    if(handle)
+        *handle = new_node;
     return SUCCESS;
 }
 
+int queue_enqueue(queue_t queue, void *data)
+{
+    return queue_enqueue_handle(queue, data, NULL);
+}
+
 int queue_dequeue(queue_t queue, void **data)
 {
     /* queue is NULL or data is NULL or queue is empty */
@@ -93,11 +104,141 @@ int queue_dequeue(queue_t queue, void **data)
     queue->head = delete_item->next;                    /* set the next head */
     if(!queue->head)                                    /* queue becomes empty */
         queue->tail = NULL;                             /* set tail NULL as well */
+    else
+        queue->head->prev = NULL;                       /* the new head is the first node */
     queue->length--;                                    /* decrement the queue size */
     free(delete_item);                                  /* deallocate the memory for the deleted item */
     return SUCCESS;
 }
 
+int queue_enqueue_many(queue_t queue, void **data, int count)
+{
+    struct queue_node *first = NULL, *last = NULL;
+    int i;
+
+    /* queue is NULL or data is NULL or count is negative */
+    if(!queue || !data || count < 0)
+        return FAILURE;
+
+    /* build the chain of new nodes on the side */
+    for(i = 0; i < count; i++)
+    {
+        struct queue_node *new_node = NULL;
+
+        /* data item is NULL or allocation failure */
+        if(data[i])
+            new_node = (struct queue_node*) malloc(sizeof(struct queue_node));
+        if(!new_node)
+        {
+            /* leave the queue untouched */
+            while(first)
+            {
+                struct queue_node *next = first->next;
+
+                free(first);
+                first = next;
+            }
+            return FAILURE;
+        }
+
+        new_node->data = data[i];
+        new_node->next = NULL;
+        new_node->prev = last;
+        if(last)
+            last->next = new_node;
+        else
+            first = new_node;
+        last = new_node;
+    }
+
+    /* nothing to enqueue */
+    if(!first)
+        return SUCCESS;
+
+    /* connect the chain after the current tail */
+    first->prev = queue->tail;
+    if(queue->tail)
+        queue->tail->next = first;
+    else
+        queue->head = first;
+    queue->tail = last;
+    queue->length += count;
+    return SUCCESS;
+}
+
+int queue_dequeue_many(queue_t queue, void **data, int count)
+{
+    int i;
+
+    /* queue is NULL or data is NULL or count is negative */
+    if(!queue || !data || count < 0)
+        return FAILURE;
+
+    for(i = 0; i < count && queue->head; i++)
+    {
+        struct queue_node *delete_item = queue->head;
+
+        data[i] = delete_item->data;
+        queue->head = delete_item->next;
+        free(delete_item);
+    }
+
+    /* queue becomes empty */
+    if(!queue->head)
+        queue->tail = NULL;
+    else
+        queue->head->prev = NULL;
+    queue->length -= i;
+    return i;
+}
+
+int queue_splice(queue_t queue, queue_t from)
+{
+    /* queue is NULL or from is NULL or they are the same */
+    if(!queue || !from || queue == from)
+        return FAILURE;
+
+    /* nothing to move */
+    if(!from->head)
+        return SUCCESS;
+
+    /* connect the nodes of from after the current tail */
+    from->head->prev = queue->tail;
+    if(queue->tail)
+        queue->tail->next = from->head;
+    else
+        queue->head = from->head;
+    queue->tail = from->tail;
+    queue->length += from->length;
+
+    /* from is now empty */
+    from->head = NULL;
+    from->tail = NULL;
+    from->length = 0;
+    return SUCCESS;
+}
+
+int queue_remove_handle(queue_t queue, queue_handle_t handle)
+{
+    /* queue is NULL or handle is NULL */
+    if(!queue || !handle)
+        return FAILURE;
+
+    /* connect the neighbours of the node together */
+    if(handle->prev)
+        handle->prev->next = handle->next;
+    else                                                 /* delete the head */
+        queue->head = handle->next;
+    if(handle->next)
+        handle->next->prev = handle->prev;
+    else                                                 /* delete the tail */
+        queue->tail = handle->prev;
+
+    queue->length--;                                     /* decrement the queue size */
+    free(handle);                                        /* deallocate the memory for the deleted item */
+    return SUCCESS;
+}
+
 int queue_delete(queue_t queue, void *data)
 {
     /* queue is NULL or data is NULL */
@@ -106,28 +247,15 @@ int queue_delete(queue_t queue, void *data)
     
     /* queue is not NULL */
     struct queue_node *current_item = queue->head;       /* get the current head */
-    struct queue_node *prev_item = NULL;
     while(current_item && current_item->data != data)    /* while not the end and not found yet */
-    {
-        prev_item = current_item;                        /* save previous item */
 	current_item = current_item->next;               /* get the next item */
-    }
 
     /* cant find it */
     if(!current_item)
         return FAILURE;
 
-    if(current_item == queue->head)                      /* delete the head */
-        queue->head = current_item->next;                /* set the new head */          
-    else                                                 /* not delete the head */       
-        prev_item->next = current_item->next;            /* connect previous item to next item */
-
-    /* delete the tail */
-    if(current_item == queue->tail)
-	queue->tail = prev_item;                         /* set the new tail */
-    queue->length--;                                     /* decrement the queue size */
-    free(current_item);                                  /* deallocate the memory for the deleted item */
-    return SUCCESS;
+    /* unlink it using its previous and next items */
+    return queue_remove_handle(queue, current_item);
 }
 
 int queue_iterate(queue_t queue, queue_func_t func, void *arg, void **data)
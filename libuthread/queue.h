@@ -8,10 +8,24 @@
  * other.  When dequeueing, the queue must returned the oldest enqueued item
  * first and so on.
  *
- * Apart from delete and iterate operations, all operations should be O(1).
+ * Apart from delete and iterate operations, all operations should be O(1). Items
+ * can also be removed in O(1) using the handle obtained when enqueuing them
+ * (for the ring buffer backend, O(1) on average until items are packed over
+ * removed ones, O(log n) after). Bulk operations are O(1) per item, and
+ * splicing is O(1) for the linked list backend.
  */
 typedef struct queue* queue_t;
 
+/*
+ * queue_handle_t - Queued item handle type
+ *
+ * A handle designates one particular item of a queue, and allows removing it
+ * in O(1) with queue_remove_handle(). A handle is valid from the moment its
+ * item is enqueued until it leaves the queue (dequeued, deleted, removed or
+ * spliced into another queue).
+ */
+typedef struct queue_node* queue_handle_t;
+
 /*
  * queue_create - Allocate an empty queue
  *
@@ -45,6 +59,20 @@ int queue_destroy(queue_t queue);
  */
 int queue_enqueue(queue_t queue, void *data);
 
+/*
+ * queue_enqueue_handle - Enqueue data item and get its handle
+ * @queue: Queue in which to enqueue item
+ * @data: Address of data item to enqueue
+ * @handle: (Optional) Address of a handle receiving the handle of the item
+ *
+ * Same as queue_enqueue(), but @handle additionally receives a handle which
+ * can later be passed to queue_remove_handle().
+ *
+ * Return: -1 if @queue or @data are NULL, or in case of memory allocation error
+ * when enqueing. 0 if @data was successfully enqueued in @queue.
+ */
+int queue_enqueue_handle(queue_t queue, void *data, queue_handle_t *handle);
+
 /*
  * queue_dequeue - Dequeue data item
  * @queue: Queue in which to dequeue item
@@ -58,6 +86,49 @@ int queue_enqueue(queue_t queue, void *data);
  */
 int queue_dequeue(queue_t queue, void **data);
 
+/*
+ * queue_enqueue_many - Enqueue several data items
+ * @queue: Queue in which to enqueue items
+ * @data: Array of addresses of data items to enqueue
+ * @count: Number of items in @data
+ *
+ * Enqueue the @count addresses contained in @data in the queue @queue, in
+ * order. Either all the items are enqueued or none is.
+ *
+ * Return: -1 if @queue or @data are NULL, if @count is negative, if any item
+ * of @data is NULL, or in case of memory allocation error when enqueing. 0 if
+ * the items were successfully enqueued in @queue.
+ */
+int queue_enqueue_many(queue_t queue, void **data, int count);
+
+/*
+ * queue_dequeue_many - Dequeue several data items
+ * @queue: Queue in which to dequeue items
+ * @data: Array receiving the dequeued items
+ * @count: Maximum number of items to dequeue
+ *
+ * Remove up to @count of the oldest items of queue @queue and assign them to
+ * @data, oldest first.
+ *
+ * Return: -1 if @queue or @data are NULL, or if @count is negative. The number
+ * of dequeued items otherwise, which is less than @count if the queue
+ * contained less items.
+ */
+int queue_dequeue_many(queue_t queue, void **data, int count);
+
+/*
+ * queue_splice - Move all the items of a queue to the end of another
+ * @queue: Queue receiving the items
+ * @from: Queue whose items are moved
+ *
+ * Append all the items of queue @from to queue @queue, keeping their order.
+ * Queue @from is left empty.
+ *
+ * Return: -1 if @queue or @from are NULL, if they are the same queue, or in
+ * case of memory allocation error. 0 if the items were successfully moved.
+ */
+int queue_splice(queue_t queue, queue_t from);
+
 /*
  * queue_delete - Delete data item
  * @queue: Queue in which to delete item
@@ -71,6 +142,19 @@ int queue_dequeue(queue_t queue, void **data);
  */
 int queue_delete(queue_t queue, void *data);
 
+/*
+ * queue_remove_handle - Remove data item designated by a handle
+ * @queue: Queue in which to remove item
+ * @handle: Handle of the item, as obtained from queue_enqueue_handle()
+ *
+ * Remove the item designated by @handle from queue @queue in O(1), wherever
+ * it is in the queue. @handle must have been obtained for an item of @queue
+ * which is still in @queue, otherwise the behavior is undefined.
+ *
+ * Return: -1 if @queue or @handle are NULL. 0 if the item was removed.
+ */
+int queue_remove_handle(queue_t queue, queue_handle_t handle);
+
 /*
  * queue_func_t - Queue callback function type
  * @data: Data item
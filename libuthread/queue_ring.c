@@ -0,0 +1,462 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "queue.h"
+
+#define FAILURE -1
+#define SUCCESS 0
+
+/* initial number of slots of a queue (must be a power of 2) */
+#define QUEUE_MIN_CAPACITY 16
+
+/* a slot of the circular array */
+struct queue_slot
+{
+    void *data;                     /* the item, NULL once removed */
+    uintptr_t seq;                  /* number of the item, increasing from head to tail */
+};
+
+/*
+ * a queue data structure backed by a growable circular array
+ *
+ * Items removed from the middle of the queue leave an empty slot (NULL) behind
+ * instead of moving the other items. Once empty slots outnumber the items, the
+ * items are packed together again. Handles are positions counted since the
+ * creation of the queue: every slot records the position of its item, which
+ * is at the index given by its handle until the queue is packed, and found by
+ * binary search after.
+ */
+struct queue
+{
+    struct queue_slot *items;       /* the slots, oldest item at index head */
+    unsigned int head;              /* index of the oldest used slot */
+    unsigned int capacity;          /* number of slots, always a power of 2 */
+    unsigned int span;              /* number of used slots, including empty ones */
+    uintptr_t base;                 /* position of the item numbered 0 */
+    uintptr_t next;                 /* position of the next item enqueued */
+    int length;                     /* the size of the queue */
+};
+
+/*
+ * queue_slot - Get the i-th oldest used slot
+ * @queue: the queue
+ * @i: index of the slot, starting from the oldest
+ */
+static inline struct queue_slot *queue_slot(queue_t queue, unsigned int i)
+{
+    return &queue->items[(queue->head + i) & (queue->capacity - 1)];
+}
+
+/*
+ * queue_push_slot - Store an item after the newest used slot
+ * @queue: the queue, with a free slot
+ * @data: the item
+ *
+ * Return: Position of the item
+ */
+static inline uintptr_t queue_push_slot(queue_t queue, void *data)
+{
+    struct queue_slot *slot = queue_slot(queue, queue->span++);
+
+    slot->data = data;
+    slot->seq = queue->next - queue->base;
+    return queue->next++;
+}
+
+/*
+ * queue_pop_slot - Release the oldest used slot
+ * @queue: the queue
+ */
+static inline void queue_pop_slot(queue_t queue)
+{
+    queue->head = (queue->head + 1) & (queue->capacity - 1);
+    queue->span--;
+}
+
+/*
+ * queue_trim_head - Release the empty slots at the head of the queue
+ * @queue: the queue
+ */
+static inline void queue_trim_head(queue_t queue)
+{
+    /* an empty queue only has empty slots left */
+    if(!queue->length)
+    {
+        queue->span = 0;
+        return;
+    }
+
+    while(!queue_slot(queue, 0)->data)
+        queue_pop_slot(queue);
+}
+
+/*
+ * queue_pack - Move the items over the empty slots, keeping their order
+ * @queue: the queue
+ */
+static void queue_pack(queue_t queue)
+{
+    struct queue_slot *slot;
+    unsigned int i, packed = 0;
+
+    for(i = 0; i < queue->span; i++)
+    {
+        slot = queue_slot(queue, i);
+        if(slot->data)
+            *queue_slot(queue, packed++) = *slot;
+    }
+    queue->span = packed;
+}
+
+/*
+ * queue_trim - Release the empty slots of the queue
+ * @queue: the queue
+ *
+ * The empty slots at both ends are released right away, the ones in the
+ * middle once they outnumber the items so that packing them costs O(1) per
+ * removal on average.
+ */
+static void queue_trim(queue_t queue)
+{
+    queue_trim_head(queue);
+    while(queue->span && !queue_slot(queue, queue->span - 1)->data)
+        queue->span--;
+
+    if(queue->span > 2 * (unsigned int)queue->length)
+        queue_pack(queue);
+}
+
+/*
+ * queue_find - Find the slot of the item at a position
+ * @queue: the queue
+ * @position: the position
+ *
+ * Positions only increase from the head to the tail, and an item is at most
+ * as far from the head as its position says, exactly as far if no slot was
+ * released in front of it by queue_pack().
+ *
+ * Return: The slot, NULL if no slot holds this position
+ */
+static struct queue_slot *queue_find(queue_t queue, uintptr_t position)
+{
+    struct queue_slot *slot;
+    uintptr_t first, offset;
+    unsigned int low = 0, high, middle;
+
+    /* the item was already dequeued or never was in the queue */
+    if(!queue->span)
+        return NULL;
+    first = queue->base + queue_slot(queue, 0)->seq;
+    offset = position - first;
+    if(offset >= queue->next - first)
+        return NULL;
+
+    /* no slot was packed in front of the item */
+    high = offset < queue->span - 1 ? offset : queue->span - 1;
+    slot = queue_slot(queue, high);
+    if(queue->base + slot->seq == position)
+        return slot;
+
+    /* offsets from the head are sorted, so are the positions */
+    while(low < high)
+    {
+        middle = low + (high - low) / 2;
+        slot = queue_slot(queue, middle);
+        if(queue->base + slot->seq - first < offset)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    slot = queue_slot(queue, low);
+    return queue->base + slot->seq == position ? slot : NULL;
+}
+
+/*
+ * queue_grow - Enlarge the array of a queue
+ * @queue: the queue
+ * @span: number of slots the queue must be able to use
+ *
+ * The number of slots is doubled until @span slots fit, and the used slots
+ * are moved to the beginning of the new array, in order.
+ *
+ * Return: -1 in case of memory allocation error. 0 otherwise.
+ */
+static int queue_grow(queue_t queue, unsigned int span)
+{
+    unsigned int first, capacity = queue->capacity;
+    struct queue_slot *items;
+
+    /* large enough already */
+    if(span <= capacity)
+        return SUCCESS;
+
+    while(capacity < span)
+        capacity *= 2;
+
+    /* slots before wrapping */
+    first = queue->span < queue->capacity - queue->head ?
+        queue->span : queue->capacity - queue->head;
+    items = (struct queue_slot*) malloc(capacity * sizeof(struct queue_slot));
+
+    /* failure of allocating new memory for the slots */
+    if(!items)
+        return FAILURE;
+
+    /* unwrap the slots: head to the end of the array, then the beginning */
+    memcpy(items, queue->items + queue->head, first * sizeof(struct queue_slot));
+    memcpy(items + first, queue->items, (queue->span - first) * sizeof(struct queue_slot));
+    free(queue->items);
+
+    queue->items = items;
+    queue->head = 0;
+    queue->capacity = capacity;
+    return SUCCESS;
+}
+
+queue_t queue_create(void)
+{
+    /* allocate memory for the queue */
+    queue_t queue = (queue_t) malloc(sizeof(struct queue));
+
+    /* failure of allocating new memory for a queue */
+    if(!queue)
+        return queue;
+
+    /* allocate the initial slots */
+    queue->items = (struct queue_slot*) malloc(QUEUE_MIN_CAPACITY * sizeof(struct queue_slot));
+    if(!queue->items)
+    {
+        free(queue);
+        return NULL;
+    }
+
+    /* initialize queue as empty */
+    queue->head = 0;
+    queue->capacity = QUEUE_MIN_CAPACITY;
+    queue->span = 0;
+    queue->base = 0;
+    queue->next = 0;
+    queue->length = 0;
+    return queue; 
+}
+
+int queue_destroy(queue_t queue)
+{
+    /* queue is NULL or not empty */
+    if(!queue || queue->length)
+	return FAILURE;
+  
+    /* queue is empty */ 
+    free(queue->items);     /* free the slots */
+    free(queue);            /* free the queue struct */
+    return SUCCESS;
+}
+
+int queue_enqueue_handle(queue_t queue, void *data, queue_handle_t *handle)
+{
+    uintptr_t position;
+
+    /* queue is NULL or data is NULL */
+    if(!queue || !data)
+        return FAILURE;
+
+    /* only allocate when all the slots are in use */
+    if(queue_grow(queue, queue->span + 1))
+        return FAILURE;
+
+    /* store after the newest item, handles start at 1 so that they are never
+     * NULL
+     */
+    position = queue_push_slot(queue, data);
+    if(handle)
+        *handle = (queue_handle_t)(position + 1);
+
+    queue->length++;                                    /* increment the queue size */ 
+    return SUCCESS;
+}
+
+int queue_enqueue(queue_t queue, void *data)
+{
+    return queue_enqueue_handle(queue, data, NULL);
+}
+
+int queue_dequeue(queue_t queue, void **data)
+{
+    /* queue is NULL or data is NULL or queue is empty */
+    if(!queue || !data || !queue->length)
+        return FAILURE;
+
+    /* the oldest slot is never empty */
+    *data = queue_slot(queue, 0)->data;                 /* get the oldest item */
+    queue_pop_slot(queue);
+    queue->length--;                                    /* decrement the queue size */
+    queue_trim_head(queue);
+    return SUCCESS;
+}
+
+int queue_enqueue_many(queue_t queue, void **data, int count)
+{
+    int i;
+
+    /* queue is NULL or data is NULL or count is negative */
+    if(!queue || !data || count < 0)
+        return FAILURE;
+
+    /* data item is NULL */
+    for(i = 0; i < count; i++)
+        if(!data[i])
+            return FAILURE;
+
+    /* make room for all the items at once */
+    if(queue_grow(queue, queue->span + count))
+        return FAILURE;
+
+    for(i = 0; i < count; i++)
+        queue_push_slot(queue, data[i]);
+    queue->length += count;
+    return SUCCESS;
+}
+
+int queue_dequeue_many(queue_t queue, void **data, int count)
+{
+    int i;
+
+    /* queue is NULL or data is NULL or count is negative */
+    if(!queue || !data || count < 0)
+        return FAILURE;
+
+    for(i = 0; i < count && queue->length; i++)
+    {
+        data[i] = queue_slot(queue, 0)->data;
+        queue_pop_slot(queue);
+        queue->length--;
+        queue_trim_head(queue);
+    }
+    return i;
+}
+
+int queue_splice(queue_t queue, queue_t from)
+{
+    struct queue_slot *slot;
+    unsigned int i;
+
+    /* queue is NULL or from is NULL or they are the same */
+    if(!queue || !from || queue == from)
+        return FAILURE;
+
+    /* an empty queue can simply take over the slots of from, numbering them
+     * from its next position on
+     */
+    if(!queue->length && from->length && from->capacity >= queue->capacity)
+    {
+        struct queue_slot *items = queue->items;
+        unsigned int capacity = queue->capacity;
+
+        queue->items = from->items;
+        queue->head = from->head;
+        queue->capacity = from->capacity;
+        queue->span = from->span;
+        queue->length = from->length;
+        queue->base = queue->next - queue_slot(queue, 0)->seq;
+        queue->next = queue->base + (from->next - from->base);
+        from->items = items;
+        from->capacity = capacity;
+    }
+    else
+    {
+        /* make room for all the items at once */
+        if(queue_grow(queue, queue->span + from->length))
+            return FAILURE;
+
+        for(i = 0; i < from->span; i++)
+        {
+            slot = queue_slot(from, i);
+            if(slot->data)
+                queue_push_slot(queue, slot->data);
+        }
+        queue->length += from->length;
+    }
+
+    /* from is now empty, and its handles are no longer valid */
+    from->head = 0;
+    from->span = 0;
+    from->length = 0;
+    return SUCCESS;
+}
+
+int queue_remove_handle(queue_t queue, queue_handle_t handle)
+{
+    struct queue_slot *slot;
+
+    /* queue is NULL or handle is NULL */
+    if(!queue || !handle)
+        return FAILURE;
+
+    /* the item was already dequeued or removed */
+    slot = queue_find(queue, (uintptr_t)handle - 1);
+    if(!slot || !slot->data)
+        return FAILURE;
+
+    slot->data = NULL;
+    queue->length--;
+    queue_trim(queue);
+    return SUCCESS;
+}
+
+int queue_delete(queue_t queue, void *data)
+{
+    unsigned int i;
+
+    /* queue is NULL or data is NULL */
+    if(!queue || !data)
+        return FAILURE;
+    
+    /* find the oldest occurrence of data */
+    for(i = 0; i < queue->span && queue_slot(queue, i)->data != data; i++)
+        ;
+
+    /* cant find it */
+    if(i == queue->span)
+        return FAILURE;
+
+    queue_slot(queue, i)->data = NULL;
+    queue->length--;
+    queue_trim(queue);
+    return SUCCESS;
+}
+
+int queue_iterate(queue_t queue, queue_func_t func, void *arg, void **data)
+{
+    unsigned int i;
+
+    /* queue is NULL or func is NULL */
+    if(!queue || !func)
+        return FAILURE;
+
+    /* go through the slots until end or func returns 1 */
+    for(i = 0; i < queue->span; i++)
+    {
+        void *item = queue_slot(queue, i)->data;
+
+        /* skip removed items */
+        if(!item)
+            continue;
+
+        /* iteration stops prematurely */
+        if((*func)(item, arg) == 1)
+        {
+            /* data is not NULL */
+            if(data)
+                *data = item;
+            break;
+        }
+    }
+    return SUCCESS;
+}
+
+int queue_length(queue_t queue)
+{
+    /* -1 if queue is NULL, length of the queue otherwise */
+    return queue ? queue->length : FAILURE;
+}
@@ -0,0 +1,227 @@
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "cycles.h"
+#include "preempt.h"
+#include "trace.h"
+#include "uthread.h"
+
+#ifdef UTHREAD_TRACE
+
+/* A recorded event */
+struct trace_entry
+{
+    uint64_t cycles;                /* timestamp of the event */
+    int arg;                        /* event-specific argument */
+    uthread_t tid;                  /* thread the event is about */
+    unsigned char type;             /* type of event */
+};
+
+static pthread_mutex_t rings_lock = PTHREAD_MUTEX_INITIALIZER; /* protects rings and ring_pids */
+static struct trace_ring *rings = NULL;       /* ring buffers written by the dump */
+static int ring_pids = 0;                     /* number of ring buffers ever allocated */
+
+/* names of the events in the dump */
+static const char *event_names[] = {
+    [TRACE_SWITCH] = "switch",
+    [TRACE_CREATE] = "create",
+    [TRACE_EXIT] = "exit",
+    [TRACE_JOIN_BLOCK] = "join_block",
+    [TRACE_WAKE] = "wake",
+    [TRACE_PREEMPT] = "preempt",
+    [TRACE_PARK] = "park",
+};
+
+void trace_record(struct trace_ring *ring, enum trace_event type,
+    uthread_t tid, int arg)
+{
+    struct trace_entry *e;
+
+    if(!__atomic_load_n(&ring->on, __ATOMIC_RELAXED))
+        return;
+
+    /* only the kernel thread running the scheduler records into its ring */
+    e = &ring->entries[ring->head & (TRACE_SIZE - 1)];
+    e->cycles = cycles_now();
+    e->type = type;
+    e->tid = tid;
+    e->arg = arg;
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * trace_ring_register - Allocate a ring buffer and make it part of the dump
+ * @ring: ring buffer of a scheduler
+ *
+ * Return: -1 in case of memory allocation failure, 0 otherwise
+ */
+static int trace_ring_register(struct trace_ring *ring)
+{
+    ring->entries = malloc(TRACE_SIZE * sizeof(struct trace_entry));
+    if(!ring->entries)
+        return -1;
+
+    /* a thread of the same kernel thread could otherwise wait for the lock */
+    preempt_disable();
+    pthread_mutex_lock(&rings_lock);
+    ring->pid = ++ring_pids;
+    ring->next = rings;
+    rings = ring;
+    pthread_mutex_unlock(&rings_lock);
+    preempt_enable();
+
+    return 0;
+}
+
+void trace_ring_release(struct trace_ring *ring)
+{
+    struct trace_ring **r;
+
+    if(!ring->entries)
+        return;
+
+    preempt_disable();
+    pthread_mutex_lock(&rings_lock);
+    for(r = &rings; *r != ring; r = &(*r)->next)
+        ;
+    *r = ring->next;
+    pthread_mutex_unlock(&rings_lock);
+    preempt_enable();
+
+    free(ring->entries);
+    ring->entries = NULL;
+}
+
+int uthread_trace_enable(int enable)
+{
+    struct trace_ring *ring = uthread_trace_ring();
+
+    if(enable && !ring->entries && trace_ring_register(ring))
+        return -1;
+
+    preempt_disable();
+
+    if(enable && !ring->on)
+    {
+        ring->head = 0;
+        ring->start_cycles = cycles_now();
+        __atomic_store_n(&ring->on, 1, __ATOMIC_RELAXED);
+
+        /* open the running interval of the current thread */
+        trace_record(ring, TRACE_SWITCH, USHRT_MAX, uthread_self());
+    }
+    else if(!enable)
+        __atomic_store_n(&ring->on, 0, __ATOMIC_RELAXED);
+
+    preempt_enable();
+    return 0;
+}
+
+/*
+ * trace_timestamp - Convert a timestamp to microseconds since the start
+ * @cycles: timestamp of an event
+ * @start: timestamp of the earliest recording start
+ */
+static double trace_timestamp(uint64_t cycles, uint64_t start)
+{
+    return cycles_to_ns(cycles - start) / 1000.0;
+}
+
+/*
+ * trace_dump_ring - Write the events recorded by one scheduler
+ * @f: file being written
+ * @ring: ring buffer of the scheduler
+ * @start: timestamp of the earliest recording start, shared by all schedulers
+ * @sep: separator written before the first event
+ */
+static void trace_dump_ring(FILE *f, struct trace_ring *ring, uint64_t start,
+    const char *sep)
+{
+    uint64_t first, i, head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+    fprintf(f, "%s\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,"
+        "\"args\":{\"name\":\"scheduler %d\"}}", sep, ring->pid, ring->pid);
+    sep = ",";
+
+    /* the oldest events were overwritten if the buffer wrapped around */
+    first = head > TRACE_SIZE ? head - TRACE_SIZE : 0;
+
+    for(i = first; i < head; i++)
+    {
+        struct trace_entry *e = &ring->entries[i & (TRACE_SIZE - 1)];
+        double ts = trace_timestamp(e->cycles, start);
+
+        if(e->type == TRACE_SWITCH)
+        {
+            /* a switch closes the interval of one thread and opens another */
+            if(e->tid != USHRT_MAX)
+                fprintf(f, "%s\n{\"name\":\"running\",\"ph\":\"E\",\"pid\":%d,"
+                    "\"tid\":%d,\"ts\":%.3f}", sep, ring->pid, e->tid, ts);
+            fprintf(f, "%s\n{\"name\":\"running\",\"ph\":\"B\",\"pid\":%d,"
+                "\"tid\":%d,\"ts\":%.3f}", sep, ring->pid, e->arg, ts);
+        }
+        else
+        {
+            fprintf(f, "%s\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%d,"
+                "\"tid\":%d,\"ts\":%.3f,\"args\":{\"arg\":%d}}", sep,
+                event_names[e->type], ring->pid, e->tid, ts, e->arg);
+        }
+    }
+}
+
+int uthread_trace_dump(const char *path)
+{
+    struct trace_ring *ring;
+    uint64_t start = UINT64_MAX;
+    const char *sep = "";
+    FILE *f;
+
+    f = fopen(path, "w");
+    if(!f)
+        return -1;
+
+    preempt_disable();
+    pthread_mutex_lock(&rings_lock);
+
+    /* stop recording while the buffers are read, remembering which ones ran */
+    for(ring = rings; ring; ring = ring->next)
+    {
+        ring->was_on = __atomic_exchange_n(&ring->on, 0, __ATOMIC_ACQ_REL);
+        if(ring->start_cycles < start)
+            start = ring->start_cycles;
+    }
+
+    fprintf(f, "{\"traceEvents\":[");
+    for(ring = rings; ring; ring = ring->next)
+    {
+        trace_dump_ring(f, ring, start, sep);
+        sep = ",";
+    }
+    fprintf(f, "\n],\"displayTimeUnit\":\"ns\"}\n");
+
+    for(ring = rings; ring; ring = ring->next)
+        if(ring->was_on)
+            __atomic_store_n(&ring->on, 1, __ATOMIC_RELAXED);
+
+    pthread_mutex_unlock(&rings_lock);
+    preempt_enable();
+
+    return fclose(f) ? -1 : 0;
+}
+
+#else /* !UTHREAD_TRACE */
+
+int uthread_trace_enable(int enable)
+{
+    return -1;
+}
+
+int uthread_trace_dump(const char *path)
+{
+    return -1;
+}
+
+#endif /* UTHREAD_TRACE */
@@ -0,0 +1,108 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <stdint.h>
+
+#include "uthread.h"
+
+/*
+ * Scheduler event tracing
+ *
+ * When the library is built with UTHREAD_TRACE defined (`make TRACE=1`),
+ * scheduler events are recorded with a cycle counter timestamp into a
+ * fixed-size ring buffer, overwriting the oldest events when full. Each
+ * scheduler has its own buffer, so kernel threads never share one. Recording
+ * starts once enabled with uthread_trace_enable() and the buffers can then be
+ * written out in the Chrome trace event format (readable by chrome://tracing
+ * and Perfetto) with uthread_trace_dump().
+ *
+ * Without UTHREAD_TRACE, the recording hooks compile to nothing.
+ */
+
+/* Number of events kept in the ring buffer (must be a power of 2) */
+#define TRACE_SIZE 65536
+
+/* Types of traced events */
+enum trace_event {
+	TRACE_SWITCH,		/* @tid switched out in favor of @arg */
+	TRACE_CREATE,		/* @tid created thread @arg */
+	TRACE_EXIT,		/* @tid exited with return value @arg */
+	TRACE_JOIN_BLOCK,	/* @tid blocked joining thread @arg */
+	TRACE_WAKE,		/* @tid made blocked thread @arg ready */
+	TRACE_PREEMPT,		/* @tid was preempted at the end of its slice */
+	TRACE_PARK,		/* @tid blocked in uthread_park() */
+};
+
+#ifdef UTHREAD_TRACE
+struct trace_entry;
+
+/* Events recorded by one scheduler */
+struct trace_ring {
+	struct trace_entry *entries;	/* TRACE_SIZE events, allocated when first enabled */
+	uint64_t head;			/* number of events ever recorded */
+	uint64_t start_cycles;		/* timestamp of the recording start */
+	int on;				/* whether events are recorded */
+	int was_on;			/* whether events were recorded before the dump */
+	int pid;			/* process the scheduler appears as in the dump */
+	struct trace_ring *next;	/* next ring written by the dump */
+};
+
+/*
+ * trace_record - Record an event in the ring buffer of a scheduler
+ * @ring: Ring buffer of the scheduler running the calling kernel thread
+ * @type: Type of event
+ * @tid: Thread the event is about
+ * @arg: Event-specific argument
+ *
+ * Must be called with preemption disabled.
+ */
+void trace_record(struct trace_ring *ring, enum trace_event type,
+		  uthread_t tid, int arg);
+
+/*
+ * trace_ring_release - Free the ring buffer of a destroyed scheduler
+ * @ring: Ring buffer to free, which is not dumped anymore
+ */
+void trace_ring_release(struct trace_ring *ring);
+
+/*
+ * uthread_trace_ring - Get the ring buffer of the calling kernel thread
+ *
+ * Implemented by the scheduler, which owns the ring buffer.
+ *
+ * Return: The ring buffer of the scheduler of the calling kernel thread
+ */
+struct trace_ring *uthread_trace_ring(void);
+
+#define TRACE(ring, type, tid, arg)	trace_record((ring), (type), (tid), (arg))
+#else
+#define TRACE(ring, type, tid, arg)	do { } while (0)
+#endif
+
+/*
+ * uthread_trace_enable - Start or stop recording events
+ * @enable: Non-zero to start recording, 0 to stop
+ *
+ * Acts on the scheduler of the calling kernel thread. Starting a recording
+ * discards the events previously recorded by this scheduler.
+ *
+ * Return: -1 if tracing support was compiled out or in case of memory
+ * allocation failure. 0 otherwise.
+ */
+int uthread_trace_enable(int enable);
+
+/*
+ * uthread_trace_dump - Write the recorded events in Chrome trace format
+ * @path: Path of the JSON file to create
+ *
+ * Every scheduler which recorded events appears as a process, numbered in the
+ * order they first enabled tracing. Each of its threads appears as a track on
+ * which the intervals where it was running are drawn, with the other events
+ * shown as instant events.
+ *
+ * Return: -1 if tracing support was compiled out or if @path cannot be
+ * written. 0 otherwise.
+ */
+int uthread_trace_dump(const char *path);
+
+#endif /* _TRACE_H */
@@ -1,28 +1,64 @@
 #include <assert.h>
+#include <errno.h>
 #include <signal.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/eventfd.h>
 #include <sys/time.h>
 #include <limits.h>
+#include <time.h>
+#include <unistd.h>
 
+#include "arena.h"
 #include "context.h"
+#include "cycles.h"
+#include "hist.h"
+#include "pqueue.h"
 #include "preempt.h"
 #include "queue.h"
+#include "trace.h"
 #include "uthread.h"
 
 /* success and failure defines */
 #define SUCCESS 0
 #define FAILURE -1
 
+/* number of threads moved to the ready queue at once by uthread_create_n() */
+#define READY_CHUNK 64
+
+/* number of stacks of exited threads kept for new threads */
+#define STACK_CACHE_SIZE 32
+
+/* default time slice bounds and scheduling period (in ns) */
+#define SLICE_MIN_NS 1000000
+#define SLICE_MAX_NS 10000000
+#define SLICE_PERIOD_NS 20000000
+
+/* number of thread functions whose stack usage is reported separately */
+#define STACK_PROFILE_SIZE 64
+
+/* number of select cases registered without allocating */
+#define SELECT_INLINE 8
+
+/* number of switches recorded before the deterministic schedule log grows */
+#define DET_LOG_SIZE 1024
+
+/* number of wait lists for parked threads (power of 2) */
+#define PARK_BITS 8
+#define PARK_BUCKETS (1 << PARK_BITS)
+
 /* enum of state of the thread */
 enum
 {
     READY,
     RUNNING,
     BLOCKED,
-    ZOMBIE
+    ZOMBIE,
+    THROTTLED
 };
 
 /* struct that holds info about the thread */
@@ -31,316 +67,3086 @@ struct thread
     uthread_t tid;                            /* thread identifier */
     int state;                                /* running, ready, blocked, etc */
     uthread_ctx_t uctx;                       /* context */
-    void *stack;                              /* the stack */
+    void *stack;                              /* the stack (NULL until first run and after exit) */
+    int has_context;                          /* whether the context was set up (first run) */
+    uthread_func_t func;                      /* function executed by the thread */
+    void *arg;                                /* argument passed to func */
     int retval;                               /* the return value of thread */
     struct thread *joined_thread;             /* the thread (blocked)that has joined to this thread */
+    int detached;                             /* whether the thread is collected without join */
+    queue_handle_t blocked_handle;            /* position of the thread in the blocked queue */
+    queue_handle_t ready_handle;              /* position of the thread in the ready queue (or NULL) */
+    uint64_t deadline;                        /* absolute deadline in ns (0 if best effort) */
+    pqueue_handle_t edf_handle;               /* position of the thread in the EDF queue (or NULL) */
+    int *park_addr;                           /* address the thread is parked on */
+    queue_handle_t park_handle;               /* position of the thread in its park bucket */
+    struct uthread_thread_stats stats;        /* scheduling statistics of the thread */
+    struct arena arena;                       /* memory freed when the thread exits */
+    uint64_t state_since;                     /* timestamp of the last state change (0 if untimed) */
+    uint64_t ready_cycles;                    /* cycle count when the thread was last made ready */
+    uint64_t dispatch_cycles;                 /* cycle count when the thread last started running */
+    uint64_t cpu_cycles;                      /* cycles spent running, up to the last dispatch */
+    struct uthread_gen *gen;                  /* generator currently run by the thread (or NULL) */
+    struct uthread_group *group;              /* group the thread is charged to (or NULL) */
 };
 
-/* define global variables */
-static uthread_ctx_t main_ctx;                /* the main context */
-static uthread_t tid_counter = 0;             /* the TID counter */
-static queue_t ready_threads = NULL;          /* a queue of the available threads */
-static queue_t zombie_threads = NULL;         /* a queue of zombie threads wait for collection */
-static queue_t blocked_threads = NULL;        /* a queue of blockced threads */
-static struct thread *current_thread = NULL;  /* current running thread */
-static struct thread threads[USHRT_MAX];      /* the container for all the threads */
+/* stack usage of the threads running a given function */
+struct stack_profile
+{
+    uthread_func_t func;                      /* the function (NULL for the overflow entry) */
+    unsigned long threads;                    /* number of threads measured */
+    unsigned long max_bytes;                  /* deepest usage */
+    unsigned long long total_bytes;           /* sum of the usages, for the mean */
+};
 
-void uthread_yield(void)
+/* request from another kernel thread, served at the next scheduling point */
+struct remote_request
 {
-    struct thread *next_thread;
-    int ret;
-    
-    /* disable preemption
-     * make sure it doesn't yield to the next of the first ready queue first
-     * if it preempts after queue dequeue or after current thread is set to next thread
-     */
-    preempt_disable();
+    struct remote_request *next;              /* next older request */
+    uthread_func_t func;                      /* function of the thread to create (NULL to unpark) */
+    void *arg;                                /* argument passed to func */
+    int *addr;                                /* address to unpark */
+    int n;                                    /* number of threads to unpark */
+};
 
-    /* get the next available thread */
-    ret = queue_dequeue(ready_threads, (void**)&next_thread); 
+/* a channel, whose values are buffered in a circular array */
+struct uthread_chan
+{
+    int capacity;                             /* number of values buffered (0 for rendezvous) */
+    int head;                                 /* position of the oldest buffered value */
+    int length;                               /* number of buffered values */
+    int closed;                               /* whether values can still be sent */
+    void **items;                             /* the buffered values */
+    queue_t senders;                          /* registrations of blocked senders */
+    queue_t receivers;                        /* registrations of blocked receivers */
+};
 
-    /* check if the queue of threads is empty */
-    if(ret == FAILURE)
-    {
-	/* re-enable preemption since return early */
-	preempt_enable();
-	return;
-    }
+/* a thread blocked in uthread_select() */
+struct select_wait
+{
+    struct thread *thread;                    /* the thread */
+    struct uthread_select_case *cases;        /* the cases, updated by the case which fires */
+    int fired;                                /* case which fired (-1 while waiting) */
+    pqueue_handle_t timer;                    /* position in the timers (or NULL) */
+};
 
-    /* save the current thread if it is running */
-    if(current_thread->state == RUNNING)
-    {
-        /* enqueue the thread only if it is not blocked */
-        current_thread->state = READY;
-        queue_enqueue(ready_threads, current_thread);
-    }
-    uthread_ctx_t *current_uctx = &(current_thread->uctx);
+/* a select case registered on the wait list of its channel */
+struct chan_waiter
+{
+    struct select_wait *wait;                 /* the select the case belongs to */
+    int index;                                /* the case */
+    queue_handle_t handle;                    /* position in the wait list (NULL once taken out) */
+};
 
-    /* set current thread with new thread */
-    next_thread->state = RUNNING;
-    current_thread = next_thread;
+/* a thread group, sharing a CPU budget per period */
+struct uthread_group
+{
+    struct uthread_sched *sched;              /* the scheduler of the threads */
+    uint64_t budget;                          /* run time per period (cycles) */
+    uint64_t period;                          /* length of the period (cycles) */
+    uint64_t period_start;                    /* cycle count at which the current period started */
+    uint64_t used;                            /* run time charged in the current period (cycles) */
+    uint64_t cpu_cycles;                      /* run time charged overall (cycles) */
+    unsigned long long throttles;             /* periods in which the budget ran out */
+    int threads;                              /* number of threads in the group */
+    int throttled;                            /* whether the budget of the period is spent */
+    queue_t throttled_threads;                /* threads which were ready when throttled, in order */
+    pqueue_handle_t handle;                   /* position in the throttled groups (or NULL) */
+};
 
-    /* re-enable preemption after yieiding to the next thread */
-    preempt_enable();
+/* enum of state of a generator */
+enum
+{
+    GEN_NEW,
+    GEN_SUSPENDED,
+    GEN_RUNNING,
+    GEN_DONE
+};
 
-    /* context switch from current to next thread */
-    uthread_ctx_switch(current_uctx, &(next_thread->uctx));   
-}
+/* a generator, which runs on its own stack inside the thread advancing it */
+struct uthread_gen
+{
+    uthread_ctx_t ctx;                        /* context of the generator */
+    uthread_ctx_t caller;                     /* context of the consumer, while the generator runs */
+    void *stack;                              /* the stack */
+    uthread_gen_func_t func;                  /* function producing the values */
+    void *arg;                                /* argument passed to func */
+    void *value;                              /* last value yielded */
+    int state;                                /* new, suspended, running or done */
+    struct uthread_gen *parent;               /* generator running when this one was advanced (or NULL) */
+};
 
-uthread_t uthread_self(void)
+/* number of TCBs allocated at once */
+#define TCB_BLOCK_SIZE 64
+#define TCB_BLOCKS ((USHRT_MAX + TCB_BLOCK_SIZE - 1) / TCB_BLOCK_SIZE)
+
+/* a scheduler instance, which owns its threads and everything they use */
+struct uthread_sched
 {
-    /* if initialized return current thread's TID
-     * else return 0 (main thread)
-     */
-    return current_thread ? current_thread->tid : 0;
-}
+    uthread_t tid_counter;                    /* the TID counter */
+    queue_t ready_threads;                    /* a queue of the available threads */
+    pqueue_t edf_threads;                     /* available threads with a deadline, earliest first */
+    queue_t zombie_threads;                   /* a queue of zombie threads wait for collection */
+    queue_t blocked_threads;                  /* a queue of blockced threads */
+    struct thread *current_thread;            /* current running thread */
+    struct thread *tcbs[TCB_BLOCKS];          /* the container for all the threads, by blocks */
+    void *stack_cache[STACK_CACHE_SIZE];      /* stacks of exited threads ready for reuse */
+    int stack_cache_length;                   /* number of stacks in the cache */
+    int stack_count;                          /* number of stacks allocated (in use or cached) */
+    void *exited_stack;                       /* stack of the last exited thread, still in use until switched away */
+    uthread_func_t exited_func;               /* function run by the last exited thread */
+    struct arena_cache arena_cache;           /* arena chunks of exited threads */
+    int stack_profiling;                      /* whether stack usage is measured */
+    struct stack_profile stack_profiles[STACK_PROFILE_SIZE + 1]; /* usage per function, then the rest */
+    int stack_profile_length;                 /* number of functions in stack_profiles */
+    int stats_timed;                          /* whether state changes are timestamped */
+    struct hist ready_latency;                /* delay between becoming ready and running (cycles) */
+    uint64_t slice_min;                       /* shortest time slice (cycles) */
+    uint64_t slice_max;                       /* longest time slice (cycles) */
+    uint64_t slice_period;                    /* period shared among runnable threads (cycles) */
+    uint64_t slice_end;                       /* cycle count at which the running thread can be preempted */
+    unsigned long long ticks;                 /* preemption ticks received */
+    unsigned long long ticks_skipped;         /* ticks which did not preempt */
+    unsigned long long edf_admitted;          /* deadlines accepted */
+    unsigned long long edf_rejected;          /* deadlines refused as already passed */
+    unsigned long long edf_overruns;          /* deadlines passed before the thread was done */
+    queue_t park_buckets[PARK_BUCKETS];       /* parked threads, hashed by address */
+    queue_t park_woken;                       /* threads being unparked, moved to the ready queue at once */
+    int attached;                             /* whether a kernel thread runs the scheduler */
+    struct remote_request *inbox;             /* requests from other kernel threads, newest first */
+    int inbox_fd;                             /* eventfd waking the scheduler when idle (-1 if none) */
+    int idle;                                 /* whether the scheduler sleeps on inbox_fd */
+    int remote;                               /* whether to wait for requests rather than report deadlocks */
+    int remote_parked;                        /* threads parked until another kernel thread unparks them */
+    pqueue_t timers;                          /* selects with a timeout, earliest first */
+    unsigned int select_rotation;             /* first case tried by the next select */
+    struct uthread_gen *gen;                  /* generator currently run before the library is initialized */
+    pqueue_t throttled_groups;                /* throttled groups, by end of period (cycles) */
+    int det;                                  /* whether the schedule is deterministic */
+    uint64_t det_rng;                         /* state of the generator choosing the next thread */
+    unsigned int det_quantum;                 /* operations between forced switches (0 for none) */
+    unsigned int det_ops;                     /* operations since the last switch */
+    uthread_t *det_log;                       /* threads switched to, in order */
+    int det_log_length;                       /* number of recorded switches */
+    int det_log_size;                         /* capacity of det_log */
+    uthread_t *det_replay;                    /* threads to switch to instead of random ones */
+    int det_replay_length;                    /* number of switches in det_replay */
+    int det_replay_pos;                       /* next switch to replay (det_replay_length once over) */
+    unsigned int stats_dump_seen;             /* dump requests already served by this scheduler */
+#ifdef UTHREAD_TRACE
+    struct trace_ring trace;                  /* events recorded by this scheduler */
+#endif
+};
+
+/* define global variables */
+static struct uthread_sched default_sched = { .inbox_fd = -1 }; /* the scheduler of the first kernel thread using the library */
+static int default_sched_taken = 0;           /* whether the default scheduler was attached */
+static __thread struct uthread_sched *sched = NULL; /* the scheduler of the calling kernel thread */
+static unsigned int stats_dump_requests = 0; /* number of dumps requested by signal */
+static int stats_dump_fd = STDERR_FILENO;     /* where signal-requested dumps are written */
 
 /*
- * uthread_init - Initializes the uthread library 
- * 
- * This function registers and initializes the main thread for later use
+ * thread_get - Find the TCB of a thread
+ * @tid: TID of the thread, whose TCB block must be allocated
  *
+ * Return: The TCB of thread @tid in the scheduler of the calling kernel thread
  */
-void uthread_init(void)
-{ 
-    /* initialize the main thread */
-    threads[tid_counter].state = RUNNING;
-    threads[tid_counter].uctx = main_ctx;
-    threads[tid_counter].joined_thread = NULL;
-    threads[tid_counter].tid = tid_counter;
-
-    /* set current running thread the main thread */
-    current_thread = &threads[tid_counter++];
-
-    /* start preemption */
-    preempt_start();
-    
-    return;
+static inline struct thread *thread_get(uthread_t tid)
+{
+    return &sched->tcbs[tid / TCB_BLOCK_SIZE][tid % TCB_BLOCK_SIZE];
 }
 
-int uthread_create(uthread_func_t func, void *arg)
+/*
+ * tcb_reserve - Allocate the TCBs of the next threads
+ * @n: number of threads about to be created
+ *
+ * TCBs are allocated by blocks as TIDs get handed out, and never move
+ * afterwards. Must be called with preemption disabled.
+ *
+ * Return: -1 in case of memory allocation failure, 0 otherwise
+ */
+static int tcb_reserve(int n)
 {
-    /* first time calling this functon */
-    if(tid_counter == 0)
-	uthread_init();
+    int block, last = (sched->tid_counter + n - 1) / TCB_BLOCK_SIZE;
 
-    /* memory allocation error */
-    if(!ready_threads || !zombie_threads || !blocked_threads)
+    for(block = sched->tid_counter / TCB_BLOCK_SIZE; block <= last; block++)
     {
-    	/* initializes global queue of threads */
-        ready_threads = queue_create();
-        zombie_threads = queue_create();
-        blocked_threads = queue_create();    
+        if(!sched->tcbs[block])
+        {
+            sched->tcbs[block] = calloc(TCB_BLOCK_SIZE, sizeof(struct thread));
+            if(!sched->tcbs[block])
+                return FAILURE;
+        }
     }
 
-    /* check TID overflow */
-    if(tid_counter == USHRT_MAX)
-        return FAILURE;  
-    
-    /* allocate memory for the stack */
-    void *stack = uthread_ctx_alloc_stack();
-    
-    /* memory allocation error */
-    if(!stack)
-	return FAILURE;
+    return SUCCESS;
+}
 
-    /* disable preemption 
-     * make sure it doesn't get overwritten by other threads
-     * if other threads also call uthread_create()
-     */
-    preempt_disable();
+/*
+ * sched_alloc - Allocate a scheduler
+ *
+ * Return: The new scheduler, NULL in case of memory allocation failure
+ */
+static struct uthread_sched *sched_alloc(void)
+{
+    struct uthread_sched *s = calloc(1, sizeof(*s));
+
+    if(s)
+        s->inbox_fd = -1;
+    return s;
+}
 
-    /* initializes the context */
-    int ret = uthread_ctx_init(&(threads[tid_counter].uctx), stack, func, arg);
-    if(ret == FAILURE)
+/*
+ * sched_attach_default - Give the calling kernel thread a scheduler
+ *
+ * The first kernel thread to use the library gets the default scheduler, the
+ * next ones get a scheduler of their own, so that the API keeps working
+ * without having to manage scheduler instances.
+ */
+static void sched_attach_default(void)
+{
+    if(!__atomic_exchange_n(&default_sched_taken, 1, __ATOMIC_ACQ_REL))
+        sched = &default_sched;
+    else if(!(sched = sched_alloc()))
     {
-	/* re-enable preemption since return early */
-	preempt_enable();
-    	return FAILURE;
+        perror("uthread_sched");
+        exit(1);
     }
-
-    /* initializes the next thread */
-    threads[tid_counter].state = READY;
-    threads[tid_counter].joined_thread = NULL;
-    threads[tid_counter].tid = tid_counter;
-    threads[tid_counter].stack = stack;
-    
-    /* add the thread to queue */
-    queue_enqueue(ready_threads, &threads[tid_counter++]);
-    
-    /* re-enable preemption */
-    preempt_enable();
-    
-    return (tid_counter - 1);
+    sched->attached = 1;
+    sched->stats_dump_seen = __atomic_load_n(&stats_dump_requests, __ATOMIC_RELAXED);
 }
 
-void uthread_exit(int retval)
+/*
+ * sched_ensure - Make sure the calling kernel thread has a scheduler
+ *
+ * Called at the beginning of every API function which may be the first one
+ * called by a kernel thread.
+ */
+static inline void sched_ensure(void)
 {
-    /* set return value */
-    current_thread->retval = retval;
+    if(!sched)
+        sched_attach_default();
+}
 
-    /* disable preemption
-     * make sure this thread is put into zombie state
-     * if the next thread is the thread that wants to join this thread
-     */
-    preempt_disable();
+/*
+ * clock_ns - Read the monotonic clock
+ *
+ * Return: Current time in nanoseconds
+ */
+static uint64_t clock_ns(void)
+{
+    struct timespec ts;
 
-    /* set current thread as zombie */
-    queue_enqueue(zombie_threads, current_thread);
-    current_thread->state = ZOMBIE;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
 
-    /* unblock joined thread if it has one */
-    if(current_thread->joined_thread)
+/*
+ * thread_set_state - Change the state of a thread
+ * @t: the thread
+ * @state: the new state
+ *
+ * When timing is enabled, the time spent in the previous state is charged to
+ * the matching counter of the thread before switching to the new state.
+ */
+static void thread_set_state(struct thread *t, int state)
+{
+    if(sched->stats_timed)
     {
-        current_thread->joined_thread->state = READY;
-	queue_enqueue(ready_threads, current_thread->joined_thread);
+        uint64_t now = clock_ns();
+
+        /* the first state change after enabling only starts the clock */
+        if(t->state_since)
+        {
+            uint64_t delta = now - t->state_since;
 
-	/* remove thread from blocked threads queue*/
-        queue_delete(blocked_threads, current_thread->joined_thread);
+            if(t->state == RUNNING)
+                t->stats.run_ns += delta;
+            else if(t->state == READY || t->state == THROTTLED)
+                t->stats.wait_ns += delta;
+            else if(t->state == BLOCKED)
+                t->stats.join_ns += delta;
+        }
+        t->state_since = now;
     }
+    t->state = state;
+}
 
-    /* re-enable preemption after making sure the joined thread is re-queued */
-    preempt_enable();
-    
-    /* yield to next available thread */
-    uthread_yield();
+/*
+ * group_park - Hold a thread of a throttled group until the next period
+ * @t: the thread, neither running nor in a ready queue
+ */
+static void group_park(struct thread *t)
+{
+    thread_set_state(t, THROTTLED);
+    t->ready_handle = NULL;
+    t->edf_handle = NULL;
+    queue_enqueue(t->group->throttled_threads, t);
 }
 
-/* delete_thread - Free the memory space allocated for the thread struct
+/*
+ * thread_enqueue_ready - Queue a ready thread according to its class
+ * @t: the thread
  *
- * @t: the thread to be freed
+ * Threads with a deadline go in the EDF queue, the others in the FIFO ready
+ * queue. Threads of a throttled group wait for the next period instead.
  */
-void delete_thread(struct thread *t)
+static void thread_enqueue_ready(struct thread *t)
 {
-    uthread_ctx_destroy_stack(t->stack);   /* free the stack space */
+    if(t->group && t->group->throttled)
+        group_park(t);
+    else if(t->deadline)
+        pqueue_push(sched->edf_threads, t->deadline, t, &t->edf_handle);
+    else
+        queue_enqueue_handle(sched->ready_threads, t, &t->ready_handle);
 }
 
-/* find_thread - Callback function that finds a thread according to its id
- * @data: thread in the queue
- * @arg: (Optional) EXtra argument to be passed to the callback function
+/*
+ * thread_make_ready - Put a thread in the ready queue
+ * @t: the thread
  *
- * This functions is usd in queue_iterate to find the thread in the queue
+ * The time at which the thread becomes ready is recorded so that the delay
+ * until it actually runs can be measured when it gets scheduled.
  */
-static int find_thread(void *data, void *arg)
+static void thread_make_ready(struct thread *t)
 {
-    struct thread *t = (struct thread*) data;
-    uthread_t match_tid = *((uthread_t*)arg);
-    
-    if (t->tid == match_tid)
-        return 1;
+    thread_set_state(t, READY);
+    t->ready_cycles = cycles_now();
+    thread_enqueue_ready(t);
+}
 
-    return 0;
+/*
+ * thread_block - Block the current thread
+ * @t: the thread
+ *
+ * The thread is recorded in the blocked queue. It is switched away from at the
+ * next scheduling point and will not run again until woken up with
+ * thread_wake(). Must be called with preemption disabled.
+ */
+static void thread_block(struct thread *t)
+{
+    thread_set_state(t, BLOCKED);
+    queue_enqueue_handle(sched->blocked_threads, t, &t->blocked_handle);
 }
 
-int uthread_join(uthread_t tid, int *retval)
-{ 
-    /* main thread not initialized */
-    if(!current_thread)
-	return FAILURE;
+/*
+ * thread_wake - Make a blocked thread ready again
+ * @t: the thread
+ *
+ * Must be called with preemption disabled.
+ */
+static void thread_wake(struct thread *t)
+{
+    TRACE(&sched->trace, TRACE_WAKE, sched->current_thread->tid, t->tid);
+    queue_remove_handle(sched->blocked_threads, t->blocked_handle);
+    thread_make_ready(t);
+}
 
-    /* main thread cannot be joined or cannot join itself */
-    if(tid == 0 || tid == current_thread->tid)
-	return FAILURE;
-    
-    struct thread *thread_in_ready = NULL;
-    struct thread *thread_in_blocked = NULL;
-    struct thread *thread_in_zombie = NULL;
+/*
+ * thread_unready - Take a ready thread out of the ready queue
+ * @t: the thread
+ *
+ * Threads queued in bulk have no handle and must be searched for.
+ */
+static void thread_unready(struct thread *t)
+{
+    if(t->edf_handle)
+        pqueue_remove(sched->edf_threads, t->edf_handle);
+    else if(t->ready_handle)
+        queue_remove_handle(sched->ready_threads, t->ready_handle);
+    else
+        queue_delete(sched->ready_threads, t);
+    t->ready_handle = NULL;
+    t->edf_handle = NULL;
+}
 
-    /* find the thread with tid in the ready threads queue */
-    queue_iterate(ready_threads, find_thread, 
-        (void*)&tid, (void**)&thread_in_ready);
-     
-    /* find the thread with tid in the blocked threads queue */
-    queue_iterate(blocked_threads, find_thread,
-        (void*)&tid, (void**)&thread_in_blocked);
-  
-    /* found the thread in ready or blocked threads */
-    if(thread_in_ready || thread_in_blocked)
-    {   
-    	struct thread *thread_to_join = thread_in_ready ? 
-            thread_in_ready : thread_in_blocked;
+/*
+ * thread_retire_deadline - Account the end of the deadline of a thread
+ * @t: the thread
+ * @now: current time in ns
+ *
+ * A deadline is met if the thread exits or sets another deadline in time.
+ */
+static void thread_retire_deadline(struct thread *t, uint64_t now)
+{
+    if(t->deadline && now > t->deadline)
+        sched->edf_overruns++;
+    t->deadline = 0;
+}
 
-       /* disable preemption
-        * make sure the found thread can only be joined once
-        * if the next thread also wants to join this found thread
-        */
-        preempt_disable();
+/*
+ * stack_profile_record - Account the stack usage of an exited thread
+ * @func: the function the thread ran
+ * @used: the number of bytes of stack it used
+ *
+ * Functions past the first STACK_PROFILE_SIZE ones share a last entry.
+ */
+static void stack_profile_record(uthread_func_t func, long used)
+{
+    struct stack_profile *p = &sched->stack_profiles[STACK_PROFILE_SIZE];
+    int i;
 
-	/* the thread has already been joined */
-	if(thread_to_join->joined_thread)
+    for(i = 0; i < sched->stack_profile_length; i++)
+    {
+        if(sched->stack_profiles[i].func == func)
         {
-	    /* re-enable preemption since return early */
-            preempt_enable();
-	    return FAILURE;
-	}
-        
-	/* save the blocked thread (current one) */
-        thread_to_join->joined_thread = current_thread;
-	current_thread->state = BLOCKED;
+            p = &sched->stack_profiles[i];
+            break;
+        }
+    }
+    if(i == sched->stack_profile_length && i < STACK_PROFILE_SIZE)
+    {
+        p = &sched->stack_profiles[sched->stack_profile_length++];
+        p->func = func;
+    }
 
-	/* add current thread to block thread */
-	queue_enqueue(blocked_threads, current_thread);
+    p->threads++;
+    p->total_bytes += used;
+    if(used > p->max_bytes)
+        p->max_bytes = used;
+}
 
-	/* re-enable preemption after registering the joined thread */
-	preempt_enable();
+/*
+ * stack_release - Give back the stack of the last exited thread
+ *
+ * An exiting thread runs on its stack until the switch to the next thread, so
+ * its stack is only released by the next call to the scheduler. The stack is
+ * kept in the cache for the next thread to start, or freed if the cache is
+ * full.
+ */
+static void stack_release(void)
+{
+    if(!sched->exited_stack)
+        return;
 
-	/* yield to next thread (it should be blocked here until joined thread dies */
-	uthread_yield();
-    }
-    
-    /* find the thread with tid in the zombie threads queue */
-    queue_iterate(zombie_threads, find_thread,
-        (void*)&tid, (void**)&thread_in_zombie);
-    
-    /* found the thread in zombie threads */
-    if(thread_in_zombie)
+    /* the stack is not in use anymore, it can be measured */
+    if(sched->stack_profiling)
     {
-       /* disable preemption
-        * make sure the found thread can only be collected once
-        * if the next thread also wants to join this found thread
-        */
-        preempt_disable();
+        long used = uthread_ctx_stack_used(sched->exited_stack);
 
-	/* the thread has already been joined */
-        if(thread_in_zombie->joined_thread
-	    && thread_in_zombie->joined_thread != current_thread)
-        {
-	    /* re-enable preemption since return early */
-            preempt_enable();
-            return FAILURE; 
-	}
+        if(used >= 0)
+            stack_profile_record(sched->exited_func, used);
+    }
 
-	/* delete the item from the zombie queue */
-	queue_delete(zombie_threads, thread_in_zombie);
+    if(sched->stack_cache_length < STACK_CACHE_SIZE)
+        sched->stack_cache[sched->stack_cache_length++] = sched->exited_stack;
+    else
+    {
+        uthread_ctx_destroy_stack(sched->exited_stack);
+        sched->stack_count--;
+    }
+    sched->exited_stack = NULL;
+}
 
-	/* main deallocates the all the queues if empty */
-        if(current_thread->tid == 0 &&
-            queue_length(ready_threads) == 0 &&
-	    queue_length(zombie_threads) == 0 && 
-	    queue_length(blocked_threads) == 0)
-        {
-            queue_destroy(ready_threads);
-            ready_threads = NULL;
-            queue_destroy(zombie_threads);
-            zombie_threads = NULL;
-	    queue_destroy(blocked_threads);
-            blocked_threads = NULL;
-	}
+/*
+ * thread_materialize - Give a thread that never ran a stack and a context
+ * @t: the thread
+ *
+ * Threads are created without stack nor context, which are only set up right
+ * before they run for the first time. The stack of a previously exited thread
+ * is reused if possible.
+ *
+ * Return: -1 in case of failure (memory allocation, context creation). 0
+ * otherwise.
+ */
+static int thread_materialize(struct thread *t)
+{
+    void *stack;
 
-	/* set return value */
-	if(retval)
-	    *retval = thread_in_zombie->retval;
+    /* take the most recently released stack, likely still in cache */
+    if(sched->stack_cache_length)
+        stack = sched->stack_cache[--sched->stack_cache_length];
+    else
+    {
+        stack = uthread_ctx_alloc_stack();
 
-	/* free the resources with the dead thread */
-        delete_thread(thread_in_zombie);
-	
-	/* re-enable preemption after collecting the thread */
-        preempt_enable();
+        /* memory allocation error */
+        if(!stack)
+            return FAILURE;
+        sched->stack_count++;
+    }
 
-	return SUCCESS;
+    /* contexts are copied from a template, no getcontext() per thread */
+    if(uthread_ctx_init_from_template(&t->uctx, stack, t->func, t->arg) == FAILURE)
+    {
+        sched->stack_cache[sched->stack_cache_length++] = stack;
+        return FAILURE;
     }
 
-    /* the thread cannot be found */ 
-    return FAILURE;
+    t->stack = stack;
+    t->has_context = 1;
+    return SUCCESS;
 }
 
+/*
+ * thread_terminate - Turn a thread into a zombie
+ * @t: the thread
+ * @retval: the return value of the thread
+ *
+ * The thread waiting to join @t, if any, is made ready. Must be called with
+ * preemption disabled.
+ */
+static void thread_terminate(struct thread *t, int retval)
+{
+    /* set return value */
+    t->retval = retval;
+
+    /* nothing can use the memory of the thread anymore */
+    arena_release(&t->arena, &sched->arena_cache);
+    if(t->deadline)
+        thread_retire_deadline(t, clock_ns());
+    /* the group is still charged for the last run of the thread, when it
+     * gets switched away from
+     */
+    if(t->group)
+        t->group->threads--;
+
+    /* set thread as zombie, detached threads are never collected */
+    TRACE(&sched->trace, TRACE_EXIT, t->tid, retval);
+    if(!t->detached)
+        queue_enqueue(sched->zombie_threads, t);
+    thread_set_state(t, ZOMBIE);
+
+    /* unblock joined thread if it has one */
+    if(t->joined_thread)
+        thread_wake(t->joined_thread);
+}
+
+/*
+ * thread_init - Initialize the TCB of a new ready thread
+ * @t: the thread
+ * @tid: the TID of the thread
+ * @func: function to be executed by the thread
+ * @arg: argument to be passed to the thread
+ *
+ * The stack and context of the thread are only set up when it is first
+ * scheduled. The caller is responsible for putting the thread in the ready
+ * queue.
+ */
+static void thread_init(struct thread *t, uthread_t tid, uthread_func_t func,
+    void *arg)
+{
+    t->state = READY;
+    t->state_since = sched->stats_timed ? clock_ns() : 0;
+    t->joined_thread = NULL;
+    t->detached = 0;
+    t->tid = tid;
+    t->stack = NULL;
+    t->ready_handle = NULL;
+    t->deadline = 0;
+    t->edf_handle = NULL;
+    t->has_context = 0;
+    t->func = func;
+    t->arg = arg;
+    memset(&t->arena, 0, sizeof(t->arena));
+    t->gen = NULL;
+    t->ready_cycles = cycles_now();
+    TRACE(&sched->trace, TRACE_CREATE, sched->current_thread->tid, t->tid);
+}
+
+/*
+ * queues_create - Allocate the queues of the scheduler if needed
+ *
+ * The queues are freed when the main thread collects the last thread, and
+ * allocated again for the next one.
+ *
+ * Return: -1 in case of memory allocation failure, 0 otherwise
+ */
+static int queues_create(void)
+{
+    if(!sched->ready_threads || !sched->zombie_threads || !sched->blocked_threads || !sched->edf_threads)
+    {
+    	/* initializes global queue of threads */
+        sched->ready_threads = queue_create();
+        sched->zombie_threads = queue_create();
+        sched->blocked_threads = queue_create();    
+        sched->edf_threads = pqueue_create();
+    }
+
+    return sched->ready_threads && sched->zombie_threads &&
+        sched->blocked_threads && sched->edf_threads ? SUCCESS : FAILURE;
+}
+
+/*
+ * thread_create - Create a new ready thread
+ * @func: function to be executed by the thread
+ * @arg: argument to be passed to the thread
+ *
+ * Must be called with preemption disabled, once the queues exist.
+ *
+ * Return: -1 in case of failure (memory allocation, TID overflow). The TID of
+ * the new thread otherwise.
+ */
+static int thread_create(uthread_func_t func, void *arg)
+{
+    struct thread *t;
+
+    /* check TID overflow */
+    if(sched->tid_counter == USHRT_MAX || tcb_reserve(1) == FAILURE)
+        return FAILURE;
+
+    /* initializes the next thread, its stack and context come later */
+    t = thread_get(sched->tid_counter);
+    thread_init(t, sched->tid_counter, func, arg);
+    
+    /* add the thread to queue */
+    queue_enqueue_handle(sched->ready_threads, t, &t->ready_handle);
+
+    return sched->tid_counter++;
+}
+
+/*
+ * park_bucket - Find the wait list of an address
+ * @addr: the address
+ *
+ * Return: Address of the wait list of the bucket @addr hashes to
+ */
+static queue_t *park_bucket(int *addr)
+{
+    uint64_t h = (uint64_t)(uintptr_t)addr >> 2;
+
+    /* multiplicative hashing, the top bits are the best mixed */
+    h *= 0x9e3779b97f4a7c15ULL;
+    return &sched->park_buckets[h >> (64 - PARK_BITS)];
+}
+
+/*
+ * wake_prepare - Make a thread of a wait queue ready, without queueing it
+ * @data: the thread
+ * @arg: counter of threads with a deadline or in a group
+ *
+ * Callback of queue_iterate() for thread_wake_queue().
+ */
+static int wake_prepare(void *data, void *arg)
+{
+    struct thread *t = data;
+
+    TRACE(&sched->trace, TRACE_WAKE, sched->current_thread->tid, t->tid);
+    queue_remove_handle(sched->blocked_threads, t->blocked_handle);
+    thread_set_state(t, READY);
+    t->ready_cycles = cycles_now();
+    t->ready_handle = NULL;
+    if(t->deadline || t->group)
+        (*(int*)arg)++;
+
+    return 0;
+}
+
+/*
+ * thread_wake_queue - Make all the threads of a wait queue ready at once
+ * @waiters: queue of blocked threads, left empty
+ *
+ * Best-effort threads are moved to the ready queue with a single splice, so
+ * they have no ready queue handle. Threads with a deadline or in a group are
+ * rare, and make the whole queue fall back to being woken up one thread at a
+ * time. Must be called with preemption disabled.
+ */
+static void thread_wake_queue(queue_t waiters)
+{
+    struct thread *t;
+    int deadlines = 0;
+
+    queue_iterate(waiters, wake_prepare, &deadlines, NULL);
+    if(!deadlines && queue_splice(sched->ready_threads, waiters) == SUCCESS)
+        return;
+
+    while(queue_dequeue(waiters, (void**)&t) == SUCCESS)
+        thread_enqueue_ready(t);
+}
+
+/*
+ * park_wake - Wake up threads parked on an address
+ * @addr: the address
+ * @n: maximum number of threads to wake up
+ *
+ * Must be called with preemption disabled.
+ *
+ * Return: The number of threads woken up
+ */
+static int park_wake(int *addr, int n)
+{
+    queue_t bucket;
+    struct thread *t;
+    int length, woken = 0;
+
+    /* nobody ever parked in this bucket */
+    bucket = *park_bucket(addr);
+    if(!bucket)
+        return 0;
+
+    /* woken threads are gathered, then moved to the ready queue at once */
+    if(!sched->park_woken)
+        sched->park_woken = queue_create();
+
+    /* go around the wait list once, threads parked on other addresses which
+     * hash to the same bucket are put back in the same order
+     */
+    length = queue_length(bucket);
+    while(length-- > 0)
+    {
+        queue_dequeue(bucket, (void**)&t);
+        if(t->park_addr == addr && woken < n)
+        {
+            t->park_addr = NULL;
+            if(!sched->park_woken || queue_enqueue(sched->park_woken, t) == FAILURE)
+            {
+                TRACE(&sched->trace, TRACE_WAKE, sched->current_thread->tid, t->tid);
+                queue_remove_handle(sched->blocked_threads, t->blocked_handle);
+                thread_make_ready(t);
+            }
+            woken++;
+        }
+        else
+            queue_enqueue_handle(bucket, t, &t->park_handle);
+    }
+    if(sched->park_woken)
+        thread_wake_queue(sched->park_woken);
+
+    return woken;
+}
+
+/*
+ * inbox_drain - Serve the requests of other kernel threads
+ *
+ * Submitted functions get a thread of their own, which is collected without
+ * join, and unpark requests wake up parked threads. Requests which cannot be
+ * served (memory allocation failure) are dropped. Must be called with
+ * preemption disabled.
+ */
+static void inbox_drain(void)
+{
+    struct remote_request *req, *next, *list = NULL;
+    int tid;
+
+    /* most switches find the inbox empty, check before taking it */
+    if(!__atomic_load_n(&sched->inbox, __ATOMIC_RELAXED))
+        return;
+    req = __atomic_exchange_n(&sched->inbox, NULL, __ATOMIC_ACQUIRE);
+
+    /* requests were pushed newest first, serve them in arrival order */
+    while(req)
+    {
+        next = req->next;
+        req->next = list;
+        list = req;
+        req = next;
+    }
+
+    for(req = list; req; req = next)
+    {
+        next = req->next;
+        if(!req->func)
+            park_wake(req->addr, req->n);
+        else if(queues_create() == SUCCESS &&
+            (tid = thread_create(req->func, req->arg)) != FAILURE)
+            thread_get(tid)->detached = 1;
+        free(req);
+    }
+}
+
+/*
+ * inbox_fd_create - Create the eventfd waking the scheduler if needed
+ *
+ * The eventfd is kept until the scheduler is destroyed, as other kernel
+ * threads may be about to write to it at any point.
+ *
+ * Return: -1 if the eventfd cannot be created, 0 otherwise
+ */
+static int inbox_fd_create(void)
+{
+    if(sched->inbox_fd < 0)
+        sched->inbox_fd = eventfd(0, EFD_CLOEXEC);
+
+    return sched->inbox_fd < 0 ? FAILURE : SUCCESS;
+}
+
+/*
+ * group_charge - Charge the run time of a thread to its group
+ * @t: the thread, which ran since its last dispatch
+ * @now: current cycle count
+ *
+ * Periods follow each other from the creation of the group, and every period
+ * which went by grants the budget again. Time used past the budget, since
+ * preemption only comes at the next tick, is paid back from the next periods.
+ * The group is throttled once its budget is spent, but the thread itself
+ * keeps running: the caller decides when it stops. Must be called with
+ * preemption disabled.
+ */
+static void group_charge(struct thread *t, uint64_t now)
+{
+    struct uthread_group *g = t->group;
+    uint64_t delta = now - t->dispatch_cycles, periods;
+
+    t->cpu_cycles += delta;
+    t->dispatch_cycles = now;
+
+    /* a throttled group is renewed by groups_refill() */
+    if(!g->throttled && now - g->period_start >= g->period)
+    {
+        periods = (now - g->period_start) / g->period;
+        g->period_start += periods * g->period;
+        g->used = g->used > periods * g->budget ? g->used - periods * g->budget : 0;
+    }
+    g->used += delta;
+    g->cpu_cycles += delta;
+
+    if(!g->throttled && g->used >= g->budget)
+    {
+        g->throttled = 1;
+        g->throttles++;
+        if(pqueue_push(sched->throttled_groups, g->period_start + g->period,
+            g, &g->handle) == FAILURE)
+        {
+            /* without being queued, the group would never be refilled */
+            g->throttled = 0;
+            g->throttles--;
+        }
+    }
+}
+
+/*
+ * groups_refill - Renew the budget of the groups whose period is over
+ * @now: current cycle count
+ *
+ * The threads of the groups are made ready again, in the order they were
+ * throttled. A group which overspent stays throttled for as many periods as
+ * needed to pay it back. Must be called with preemption disabled.
+ */
+static void groups_refill(uint64_t now)
+{
+    struct uthread_group *g;
+    struct thread *t;
+    uint64_t end;
+
+    if(!sched->throttled_groups)
+        return;
+
+    while(pqueue_peek(sched->throttled_groups, (void**)&g, &end) == SUCCESS &&
+        end <= now)
+    {
+        pqueue_remove(sched->throttled_groups, g->handle);
+        g->period_start = end;
+        g->used -= g->budget;
+        if(g->used >= g->budget)
+        {
+            pqueue_push(sched->throttled_groups, end + g->period, g, &g->handle);
+            continue;
+        }
+
+        g->handle = NULL;
+        g->throttled = 0;
+        while(queue_dequeue(g->throttled_threads, (void**)&t) == SUCCESS)
+            thread_make_ready(t);
+    }
+}
+
+/*
+ * timers_expire - Wake up the selects whose timeout expired
+ *
+ * Must be called with preemption disabled.
+ */
+static void timers_expire(void)
+{
+    struct select_wait *wait;
+    uint64_t deadline, now;
+
+    if(!sched->timers || !pqueue_length(sched->timers))
+        return;
+
+    now = clock_ns();
+    while(pqueue_peek(sched->timers, (void**)&wait, &deadline) == SUCCESS &&
+        deadline <= now)
+    {
+        pqueue_pop(sched->timers, (void**)&wait, NULL);
+        wait->timer = NULL;
+        wait->fired = UTHREAD_SELECT_TIMEOUT;
+        thread_wake(wait->thread);
+    }
+}
+
+/*
+ * idle_wait - Sleep until a timeout expires, a throttled group gets its budget
+ * back, or other kernel threads send requests
+ *
+ * Called when no thread can run. Other kernel threads only write to the
+ * eventfd when they see the scheduler sleeping, so that the busy path does
+ * not make any system call. Must be called with preemption disabled.
+ *
+ * Return: 1 after sleeping, once expired timeouts and received requests were
+ * served. 0 if nothing could ever wake a thread up.
+ */
+static int idle_wait(void)
+{
+    int remote = sched->remote || sched->remote_parked;
+    struct pollfd pfd = { .fd = sched->inbox_fd, .events = POLLIN };
+    struct timespec timeout, *tp = NULL;
+    uint64_t deadline, refill, now, count;
+    int ret, timed = 0, timeout_ms = -1;
+
+    /* the earliest timeout bounds the sleep */
+    if(sched->timers && pqueue_peek(sched->timers, NULL, &deadline) == SUCCESS)
+    {
+        now = clock_ns();
+        deadline = deadline > now ? deadline - now : 0;
+        timed = 1;
+    }
+
+    /* and so does the end of the period of the first throttled group */
+    if(sched->throttled_groups &&
+        pqueue_peek(sched->throttled_groups, NULL, &refill) == SUCCESS)
+    {
+        now = cycles_now();
+        refill = refill > now ? cycles_to_ns(refill - now) : 0;
+        if(!timed || refill < deadline)
+            deadline = refill;
+        timed = 1;
+    }
+
+    if(timed)
+    {
+        timeout.tv_sec = deadline / 1000000000ULL;
+        timeout.tv_nsec = deadline % 1000000000ULL;
+        tp = &timeout;
+
+        /* poll() counts in milliseconds, rather wake up late than early */
+        timeout_ms = (deadline + 999999) / 1000000;
+    }
+    else if(!remote)
+        return 0;
+
+    if(remote)
+    {
+        /* announce the sleep before the last check, submitters do the opposite */
+        __atomic_store_n(&sched->idle, 1, __ATOMIC_SEQ_CST);
+        ret = __atomic_load_n(&sched->inbox, __ATOMIC_SEQ_CST) ? 0 :
+            poll(&pfd, 1, timeout_ms);
+        __atomic_store_n(&sched->idle, 0, __ATOMIC_SEQ_CST);
+
+        if(ret > 0)
+            while(read(sched->inbox_fd, &count, sizeof(count)) < 0 && errno == EINTR)
+                ;
+        else if(ret < 0 && errno != EINTR && !tp)
+            return 0;
+    }
+    else
+        nanosleep(tp, NULL);
+
+    timers_expire();
+    groups_refill(cycles_now());
+    inbox_drain();
+    return 1;
+}
+
+/*
+ * det_random - Draw the next pseudo-random number of the schedule
+ *
+ * SplitMix64, which only needs one 64-bit word of state.
+ *
+ * Return: The next number of the sequence started by the seed
+ */
+static uint64_t det_random(void)
+{
+    uint64_t z = (sched->det_rng += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+/*
+ * det_nth - Find the thread at a given position of the ready queue
+ * @data: the thread
+ * @arg: number of threads left to skip
+ *
+ * Callback of queue_iterate() for det_pick().
+ */
+static int det_nth(void *data, void *arg)
+{
+    return (*(int*)arg)-- == 0;
+}
+
+/*
+ * det_pick - Take the next thread out of the ready queue in deterministic mode
+ *
+ * The thread named by the replayed schedule goes next if it is ready, a
+ * thread drawn at random otherwise. Must be called with preemption disabled.
+ *
+ * Return: The thread, NULL if the ready queue is empty
+ */
+static struct thread *det_pick(void)
+{
+    struct thread *t = NULL;
+    uthread_t tid;
+    int n = queue_length(sched->ready_threads);
+
+    if(n <= 0)
+        return NULL;
+
+    if(sched->det_replay_pos < sched->det_replay_length)
+    {
+        tid = sched->det_replay[sched->det_replay_pos];
+        if(tid < sched->tid_counter && thread_get(tid)->state == READY &&
+            !thread_get(tid)->edf_handle)
+            t = thread_get(tid);
+    }
+    if(!t)
+    {
+        n = det_random() % n;
+        queue_iterate(sched->ready_threads, det_nth, &n, (void**)&t);
+    }
+
+    thread_unready(t);
+    return t;
+}
+
+/*
+ * det_record - Record a switch in deterministic mode
+ * @t: the thread switched to
+ *
+ * The replay stops at the first switch which differs from the replayed
+ * schedule, the rest of the schedule is then drawn at random. Must be called
+ * with preemption disabled.
+ */
+static void det_record(struct thread *t)
+{
+    uthread_t *log;
+
+    if(sched->det_replay_pos < sched->det_replay_length)
+    {
+        if(sched->det_replay[sched->det_replay_pos] == t->tid)
+            sched->det_replay_pos++;
+        else
+            sched->det_replay_pos = sched->det_replay_length;
+    }
+
+    /* the log doubles when full, switches are dropped if it cannot grow */
+    sched->det_ops = 0;
+    if(sched->det_log_length == sched->det_log_size)
+    {
+        int size = sched->det_log_size ? 2 * sched->det_log_size : DET_LOG_SIZE;
+
+        if(!(log = realloc(sched->det_log, size * sizeof(uthread_t))))
+            return;
+        sched->det_log = log;
+        sched->det_log_size = size;
+    }
+    sched->det_log[sched->det_log_length++] = t->tid;
+}
+
+/*
+ * slice_start - Start the time slice of the thread about to run
+ * @now: current cycle count
+ * @handoff: whether the thread was handed off to, and runs for the remainder
+ * of the slice of the thread which handed off
+ *
+ * The scheduling period is shared among the runnable threads, within bounds:
+ * slices are short when many threads wait, and long when few do. The slice of
+ * a thread of a group ends when the budget of the group runs out. Must be
+ * called with preemption disabled, once the ready queues and the current
+ * thread are up to date.
+ */
+static void slice_start(uint64_t now, int handoff)
+{
+    struct uthread_group *g = sched->current_thread ? sched->current_thread->group : NULL;
+    uint64_t slice;
+    int runnable = 1;
+
+    if(handoff)
+        slice = (int64_t)(sched->slice_end - now) > 0 ? sched->slice_end - now : 0;
+    else
+    {
+        /* queues do not exist before the first thread creation */
+        if(sched->ready_threads)
+            runnable += queue_length(sched->ready_threads) + pqueue_length(sched->edf_threads);
+
+        slice = sched->slice_period / runnable;
+        if(slice < sched->slice_min)
+            slice = sched->slice_min;
+        else if(slice > sched->slice_max)
+            slice = sched->slice_max;
+    }
+    if(g && g->used < g->budget && g->budget - g->used < slice)
+        slice = g->budget - g->used;
+    sched->slice_end = now + slice;
+}
+
+/*
+ * uthread_schedule - Switch to the next ready thread
+ * @preempted: whether the switch is forced by the preemption timer
+ * @target: (Optional) thread to switch to instead of the oldest ready thread
+ *
+ * Return: 0 if the calling thread handed off to @target. -1 if @target was not
+ * ready (or NULL) and the oldest ready thread was picked instead, or if there
+ * was no thread to switch to.
+ */
+static int uthread_schedule(int preempted, struct thread *target)
+{
+    struct thread *next_thread;
+    uint64_t now;
+    int ret, slept, handoff = FAILURE;
+    
+    /* a dump was requested asynchronously, do it from a safe place: not
+     * from the preemption signal handler. Every scheduler serves each
+     * request once, so it compares the requests it already served
+     */
+    if(!preempted)
+    {
+        unsigned int requests = __atomic_load_n(&stats_dump_requests, __ATOMIC_RELAXED);
+
+        if(requests != sched->stats_dump_seen)
+        {
+            sched->stats_dump_seen = requests;
+            uthread_stats_dump(stats_dump_fd);
+        }
+    }
+
+    /* disable preemption
+     * make sure it doesn't yield to the next of the first ready queue first
+     * if it preempts after queue dequeue or after current thread is set to next thread
+     */
+    preempt_disable();
+
+    /* threads submitted from other kernel threads compete like the others */
+    inbox_drain();
+    timers_expire();
+
+    /* a thread whose group spent its budget stops here until the next period */
+    now = cycles_now();
+    groups_refill(now);
+    if(sched->current_thread->group)
+    {
+        group_charge(sched->current_thread, now);
+        if(sched->current_thread->state == RUNNING && sched->current_thread->group->throttled)
+            group_park(sched->current_thread);
+    }
+
+    /* the last exited thread is not running anymore */
+    stack_release();
+
+    /* only a ready thread can be handed off to */
+    if(target && (target == sched->current_thread || target->state != READY))
+        target = NULL;
+
+    /* a running thread with a deadline only gives the processor to a more
+     * urgent one, so no best-effort thread runs while it is ready. It takes
+     * turns with threads of the same deadline when yielding, not when
+     * preempted
+     */
+    if(!target && sched->current_thread->deadline && sched->current_thread->state == RUNNING)
+    {
+        uint64_t earliest;
+
+        if(pqueue_peek(sched->edf_threads, NULL, &earliest) == FAILURE ||
+            sched->current_thread->deadline < earliest ||
+            (preempted && sched->current_thread->deadline == earliest))
+        {
+            slice_start(cycles_now(), 0);
+            preempt_enable();
+            return FAILURE;
+        }
+    }
+
+    while(1)
+    {
+        if(target)
+        {
+            /* directed handoff, the target jumps the queue */
+            next_thread = target;
+            thread_unready(next_thread);
+            handoff = SUCCESS;
+            target = NULL;
+        }
+        else if(pqueue_pop(sched->edf_threads, (void**)&next_thread, NULL) == SUCCESS)
+        {
+            /* threads with a deadline always go first, earliest first */
+            next_thread->edf_handle = NULL;
+            handoff = FAILURE;
+        }
+        else if(sched->det && (next_thread = det_pick()))
+        {
+            /* any ready thread may go next, as the seed decides */
+            handoff = FAILURE;
+        }
+        else
+        {
+            /* get the next available thread */
+            ret = queue_dequeue(sched->ready_threads, (void**)&next_thread); 
+
+            /* check if the queue of threads is empty */
+            if(ret == FAILURE)
+            {
+                /* blocked threads may still be woken up by a timeout, a
+                 * new period or another kernel thread
+                 */
+                if(sched->current_thread->state != RUNNING)
+                {
+                    /* the time spent asleep is not run time of the thread */
+                    now = cycles_now();
+                    sched->current_thread->cpu_cycles += now - sched->current_thread->dispatch_cycles;
+                    slept = idle_wait();
+                    sched->current_thread->dispatch_cycles = slept ? cycles_now() : now;
+                    if(slept)
+                        continue;
+                }
+
+                /* nobody else to run, the thread starts a new slice */
+                slice_start(cycles_now(), 0);
+
+	        /* re-enable preemption since return early */
+	        preempt_enable();
+	        return FAILURE;
+            }
+            next_thread->ready_handle = NULL;
+            handoff = FAILURE;
+        }
+
+        /* members of a throttled group left in the ready queues wait too */
+        if(next_thread->group && next_thread->group->throttled)
+        {
+            group_park(next_thread);
+            continue;
+        }
+
+        /* threads get their stack and context when they first run */
+        if(next_thread->has_context || thread_materialize(next_thread) == SUCCESS)
+            break;
+
+        /* the thread cannot be started, it exits right away */
+        thread_terminate(next_thread, FAILURE);
+    }
+
+    /* the schedule can be replayed from the threads it switched to */
+    if(sched->det)
+        det_record(next_thread);
+
+    /* account the switch to the thread giving up the processor */
+    sched->current_thread->stats.switches++;
+    if(preempted)
+        sched->current_thread->stats.preempted++;
+    else
+        sched->current_thread->stats.voluntary++;
+
+    /* save the current thread if it is running */
+    if(sched->current_thread->state == RUNNING)
+    {
+        /* enqueue the thread only if it is not blocked */
+        thread_make_ready(sched->current_thread);
+    }
+    else if(sched->current_thread->state == ZOMBIE)
+    {
+        /* the stack can be reused once switched away from it */
+        sched->exited_stack = sched->current_thread->stack;
+        sched->exited_func = sched->current_thread->func;
+        sched->current_thread->stack = NULL;
+    }
+    uthread_ctx_t *current_uctx = &(sched->current_thread->uctx);
+
+    /* charge the run time of the thread and start the slice of the next one */
+    now = cycles_now();
+    sched->current_thread->cpu_cycles += now - sched->current_thread->dispatch_cycles;
+    next_thread->dispatch_cycles = now;
+
+    /* set current thread with new thread */
+    TRACE(&sched->trace, TRACE_SWITCH, sched->current_thread->tid, next_thread->tid);
+    hist_record(&sched->ready_latency, now - next_thread->ready_cycles);
+    thread_set_state(next_thread, RUNNING);
+    sched->current_thread = next_thread;
+    slice_start(now, handoff == SUCCESS);
+
+    /* context switch from current to next thread
+     * preemption stays disabled until the switch is done: a tick in between
+     * would save the context of this thread as the one of the next thread
+     */
+    uthread_ctx_switch(current_uctx, &(next_thread->uctx));   
+
+    /* re-enable preemption once switched back to */
+    preempt_enable();
+
+    return handoff;
+}
+
+int uthread_yield_to(uthread_t tid)
+{
+    sched_ensure();
+
+    /* unknown threads cannot be handed off to */
+    if(tid >= sched->tid_counter)
+    {
+        uthread_yield();
+        return FAILURE;
+    }
+
+    /* the current quantum is not restarted, the target gets what is left */
+    return uthread_schedule(0, thread_get(tid));
+}
+
+void uthread_preempt_yield(void)
+{
+    /* the signal may land on a kernel thread without any scheduler */
+    if(!sched || !sched->current_thread)
+        return;
+
+    /* the tick only preempts a thread which used up its time slice, and
+     * never in deterministic mode, where operations are counted instead
+     */
+    sched->ticks++;
+    if(sched->det || (int64_t)(cycles_now() - sched->slice_end) < 0)
+    {
+        sched->ticks_skipped++;
+        return;
+    }
+
+    TRACE(&sched->trace, TRACE_PREEMPT, sched->current_thread->tid, 0);
+    uthread_schedule(1, NULL);
+}
+
+/*
+ * det_op - Count a scheduling operation in deterministic mode
+ *
+ * Called at the beginning of the API functions which touch the state of other
+ * threads. Once the quantum is reached, the running thread is preempted right
+ * there, which only depends on the order of the operations. Must be called
+ * with preemption enabled.
+ */
+static void det_op(void)
+{
+    if(!sched->det || !sched->det_quantum || !sched->current_thread)
+        return;
+
+    if(++sched->det_ops >= sched->det_quantum)
+    {
+        sched->det_ops = 0;
+        TRACE(&sched->trace, TRACE_PREEMPT, sched->current_thread->tid, 0);
+        uthread_schedule(1, NULL);
+    }
+}
+
+void uthread_det_point(void)
+{
+    sched_ensure();
+    det_op();
+}
+
+void uthread_det_enable(unsigned long long seed, unsigned int quantum)
+{
+    sched_ensure();
+
+    preempt_disable();
+    sched->det = 1;
+    sched->det_rng = seed;
+    sched->det_quantum = quantum;
+    sched->det_ops = 0;
+    sched->det_log_length = 0;
+    sched->det_replay_pos = sched->det_replay_length;
+    preempt_enable();
+}
+
+void uthread_det_disable(void)
+{
+    sched_ensure();
+
+    /* the recorded schedule stays available */
+    preempt_disable();
+    sched->det = 0;
+    sched->det_replay_pos = sched->det_replay_length;
+    preempt_enable();
+}
+
+int uthread_det_trace(uthread_t *trace, int n)
+{
+    sched_ensure();
+
+    if(n < 0 || (n && !trace))
+        return FAILURE;
+
+    /* the log moves when it grows */
+    preempt_disable();
+    if(n > sched->det_log_length)
+        n = sched->det_log_length;
+    if(n)
+        memcpy(trace, sched->det_log, n * sizeof(uthread_t));
+    n = sched->det_log_length;
+    preempt_enable();
+
+    return n;
+}
+
+int uthread_det_replay(const uthread_t *trace, int n)
+{
+    uthread_t *replay;
+
+    sched_ensure();
+
+    if(!sched->det || n < 0 || (n && !trace))
+        return FAILURE;
+
+    if(n > sched->det_replay_length)
+    {
+        if(!(replay = realloc(sched->det_replay, n * sizeof(uthread_t))))
+            return FAILURE;
+        sched->det_replay = replay;
+    }
+
+    preempt_disable();
+    if(n)
+        memcpy(sched->det_replay, trace, n * sizeof(uthread_t));
+    sched->det_replay_length = n;
+    sched->det_replay_pos = 0;
+    preempt_enable();
+
+    return SUCCESS;
+}
+
+int uthread_set_timeslice(unsigned long long min_ns, unsigned long long max_ns,
+    unsigned long long period_ns)
+{
+    uint64_t min, max, period;
+
+    sched_ensure();
+
+    if(!min_ns || min_ns > max_ns)
+        return FAILURE;
+
+    /* conversions may calibrate the counter, do it outside the critical section */
+    min = ns_to_cycles(min_ns);
+    max = ns_to_cycles(max_ns);
+    period = ns_to_cycles(period_ns);
+
+    preempt_disable();
+    sched->slice_min = min;
+    sched->slice_max = max;
+    sched->slice_period = period;
+    preempt_enable();
+
+    return SUCCESS;
+}
+
+uthread_t uthread_self(void)
+{
+    /* if initialized return current thread's TID
+     * else return 0 (main thread)
+     */
+    return sched && sched->current_thread ? sched->current_thread->tid : 0;
+}
+
+uthread_sched_t uthread_sched_create(void)
+{
+    return sched_alloc();
+}
+
+int uthread_sched_attach(uthread_sched_t s)
+{
+    if(!s || s->attached || sched)
+        return FAILURE;
+
+    s->attached = 1;
+    s->stats_dump_seen = __atomic_load_n(&stats_dump_requests, __ATOMIC_RELAXED);
+    sched = s;
+    return SUCCESS;
+}
+
+uthread_sched_t uthread_sched_self(void)
+{
+    return sched;
+}
+
+#ifdef UTHREAD_TRACE
+struct trace_ring *uthread_trace_ring(void)
+{
+    sched_ensure();
+    return &sched->trace;
+}
+#endif
+
+int uthread_sched_destroy(uthread_sched_t s)
+{
+    int i;
+
+    /* the default scheduler is not allocated, other kernel threads' are busy */
+    if(!s || s == &default_sched || (s->attached && s != sched))
+        return FAILURE;
+
+    /* only the main thread may be left */
+    if(s->current_thread && s->current_thread->tid != 0)
+        return FAILURE;
+    if((s->ready_threads && queue_length(s->ready_threads)) ||
+        (s->edf_threads && pqueue_length(s->edf_threads)) ||
+        (s->zombie_threads && queue_length(s->zombie_threads)) ||
+        (s->blocked_threads && queue_length(s->blocked_threads)) ||
+        (s->throttled_groups && pqueue_length(s->throttled_groups)) ||
+        __atomic_load_n(&s->inbox, __ATOMIC_ACQUIRE))
+        return FAILURE;
+
+    /* detach first so that a preemption tick finds no scheduler */
+    preempt_disable();
+    if(s == sched)
+    {
+        sched = NULL;
+        preempt_stop();
+    }
+    preempt_enable();
+
+    if(s->ready_threads)
+        queue_destroy(s->ready_threads);
+    if(s->edf_threads)
+        pqueue_destroy(s->edf_threads);
+    if(s->zombie_threads)
+        queue_destroy(s->zombie_threads);
+    if(s->blocked_threads)
+        queue_destroy(s->blocked_threads);
+    for(i = 0; i < PARK_BUCKETS; i++)
+        if(s->park_buckets[i])
+            queue_destroy(s->park_buckets[i]);
+    if(s->park_woken)
+        queue_destroy(s->park_woken);
+    if(s->timers)
+        pqueue_destroy(s->timers);
+    if(s->throttled_groups)
+        pqueue_destroy(s->throttled_groups);
+    free(s->det_log);
+    free(s->det_replay);
+
+    /* stacks of exited threads, then memory of the main thread's arena */
+    uthread_ctx_destroy_stack(s->exited_stack);
+    for(i = 0; i < s->stack_cache_length; i++)
+        uthread_ctx_destroy_stack(s->stack_cache[i]);
+    if(s->tcbs[0])
+        arena_release(&s->tcbs[0][0].arena, &s->arena_cache);
+    arena_cache_destroy(&s->arena_cache);
+    if(s->inbox_fd >= 0)
+        close(s->inbox_fd);
+#ifdef UTHREAD_TRACE
+    trace_ring_release(&s->trace);
+#endif
+
+    for(i = 0; i < TCB_BLOCKS; i++)
+        free(s->tcbs[i]);
+    free(s);
+
+    return SUCCESS;
+}
+
+/*
+ * uthread_init - Initializes the uthread library 
+ * 
+ * This function registers and initializes the main thread for later use
+ *
+ */
+void uthread_init(void)
+{ 
+    struct thread *main_thread;
+
+    /* the TCB of the main thread, its context is saved when switched out */
+    if(tcb_reserve(1) == FAILURE)
+    {
+        perror("uthread_init");
+        exit(1);
+    }
+    main_thread = thread_get(sched->tid_counter);
+
+    /* initialize the main thread */
+    main_thread->state = RUNNING;
+    main_thread->state_since = sched->stats_timed ? clock_ns() : 0;
+    main_thread->has_context = 1;
+    main_thread->joined_thread = NULL;
+    main_thread->tid = sched->tid_counter;
+
+    /* uthread_init() may be reached from a generator */
+    main_thread->gen = sched->gen;
+    sched->gen = NULL;
+
+    /* default time slices, unless configured beforehand */
+    if(!sched->slice_min)
+        uthread_set_timeslice(SLICE_MIN_NS, SLICE_MAX_NS, SLICE_PERIOD_NS);
+
+    /* set current running thread the main thread */
+    sched->current_thread = main_thread;
+    sched->tid_counter++;
+    sched->current_thread->dispatch_cycles = cycles_now();
+    slice_start(sched->current_thread->dispatch_cycles, 0);
+
+    /* start preemption */
+    preempt_start();
+    
+    return;
+}
+
+/*
+ * uthread_setup - Initialize the library and the queues if needed
+ *
+ * Called at the beginning of every thread creation.
+ */
+static void uthread_setup(void)
+{
+    sched_ensure();
+
+    /* first time calling this functon */
+    if(sched->tid_counter == 0)
+	uthread_init();
+
+    /* the queues may have been freed with the last thread */
+    queues_create();
+}
+
+void uthread_yield(void)
+{
+    sched_ensure();
+
+    /* the main thread may yield before any thread was created */
+    if(!sched->current_thread)
+        uthread_setup();
+
+    uthread_schedule(0, NULL);
+}
+
+int uthread_create(uthread_func_t func, void *arg)
+{
+    int tid;
+
+    uthread_setup();
+    det_op();
+
+    /* disable preemption 
+     * make sure it doesn't get overwritten by other threads
+     * if other threads also call uthread_create()
+     */
+    preempt_disable();
+    tid = thread_create(func, arg);
+    
+    /* re-enable preemption */
+    preempt_enable();
+    
+    return tid;
+}
+
+int uthread_create_n(uthread_func_t func, void **args, int n, uthread_t *tids)
+{
+    int i;
+
+    if(!func || n <= 0)
+        return FAILURE;
+
+    uthread_setup();
+    det_op();
+
+    /* check TID overflow for the whole batch */
+    if(n > USHRT_MAX - sched->tid_counter)
+        return FAILURE;
+
+    /* disable preemption once for the whole batch */
+    preempt_disable();
+
+    if(tcb_reserve(n) == FAILURE)
+    {
+        preempt_enable();
+        return FAILURE;
+    }
+
+    for(i = 0; i < n; i++)
+    {
+        struct thread *t = thread_get(sched->tid_counter + i);
+
+        thread_init(t, sched->tid_counter + i, func, args ? args[i] : NULL);
+        if(tids)
+            tids[i] = t->tid;
+    }
+
+    /* make the threads ready in creation order, a chunk at a time */
+    for(i = 0; i < n; i += READY_CHUNK)
+    {
+        void *chunk[READY_CHUNK];
+        int j, count = n - i < READY_CHUNK ? n - i : READY_CHUNK;
+
+        for(j = 0; j < count; j++)
+            chunk[j] = thread_get(sched->tid_counter + i + j);
+        if(queue_enqueue_many(sched->ready_threads, chunk, count) == FAILURE)
+        {
+            /* take the threads of the previous chunks out again, their TIDs
+             * are given to the next threads created
+             */
+            for(j = 0; j < i; j++)
+                queue_delete(sched->ready_threads, thread_get(sched->tid_counter + j));
+            preempt_enable();
+            return FAILURE;
+        }
+    }
+    sched->tid_counter += n;
+
+    /* re-enable preemption */
+    preempt_enable();
+
+    return n;
+}
+
+void uthread_exit(int retval)
+{
+    sched_ensure();
+
+    /* disable preemption
+     * make sure this thread is put into zombie state
+     * if the next thread is the thread that wants to join this thread
+     */
+    preempt_disable();
+
+    /* set current thread as zombie and wake up its joining thread */
+    thread_terminate(sched->current_thread, retval);
+
+    /* re-enable preemption after making sure the joined thread is re-queued */
+    preempt_enable();
+    
+    /* yield to next available thread */
+    uthread_yield();
+}
+
+/* delete_thread - Free the memory space allocated for the thread struct
+ *
+ * @t: the thread to be freed
+ */
+void delete_thread(struct thread *t)
+{
+    /* the stack is normally reclaimed as soon as the thread is switched away */
+    if(t->stack)
+    {
+        uthread_ctx_destroy_stack(t->stack);   /* free the stack space */
+        t->stack = NULL;
+        sched->stack_count--;
+    }
+}
+
+/* find_thread - Callback function that finds a thread according to its id
+ * @data: thread in the queue
+ * @arg: (Optional) EXtra argument to be passed to the callback function
+ *
+ * This functions is usd in queue_iterate to find the thread in the queue
+ */
+static int find_thread(void *data, void *arg)
+{
+    struct thread *t = (struct thread*) data;
+    uthread_t match_tid = *((uthread_t*)arg);
+    
+    if (t->tid == match_tid)
+        return 1;
+
+    return 0;
+}
+
+int uthread_join(uthread_t tid, int *retval)
+{ 
+    sched_ensure();
+
+    /* main thread not initialized */
+    if(!sched->current_thread)
+	return FAILURE;
+
+    /* main thread cannot be joined or cannot join itself */
+    if(tid == 0 || tid == sched->current_thread->tid)
+	return FAILURE;
+
+    /* submitted threads are collected on their own */
+    if(tid < sched->tid_counter && thread_get(tid)->detached)
+	return FAILURE;
+    
+    struct thread *thread_to_join = NULL;
+    struct thread *thread_in_zombie = NULL;
+
+    /* disable preemption
+     * make sure the thread does not exit between finding it alive and
+     * registering as its joiner, and that the zombie queue does not change
+     * while it is searched
+     */
+    preempt_disable();
+
+    /* the thread is ready (in either ready queue or throttled) or blocked
+     * TIDs are never reused so the TCB tells if the thread is still alive
+     */
+    if(tid < sched->tid_counter &&
+        (thread_get(tid)->state == READY || thread_get(tid)->state == BLOCKED ||
+        thread_get(tid)->state == THROTTLED))
+        thread_to_join = thread_get(tid);
+  
+    /* found the thread in ready or blocked threads */
+    if(thread_to_join)
+    {   
+	/* the thread has already been joined */
+	if(thread_to_join->joined_thread)
+        {
+	    /* re-enable preemption since return early */
+            preempt_enable();
+	    return FAILURE;
+	}
+        
+	/* save the blocked thread (current one) */
+        thread_to_join->joined_thread = sched->current_thread;
+	TRACE(&sched->trace, TRACE_JOIN_BLOCK, sched->current_thread->tid, tid);
+
+	/* add current thread to block thread */
+	thread_block(sched->current_thread);
+
+	/* re-enable preemption after registering the joined thread */
+	preempt_enable();
+
+	/* yield to next thread (it should be blocked here until joined thread dies */
+	uthread_yield();
+        preempt_disable();
+    }
+    
+    /* find the thread with tid in the zombie threads queue */
+    queue_iterate(sched->zombie_threads, find_thread,
+        (void*)&tid, (void**)&thread_in_zombie);
+    
+    /* found the thread in zombie threads */
+    if(thread_in_zombie)
+    {
+	/* the thread has already been joined */
+        if(thread_in_zombie->joined_thread
+	    && thread_in_zombie->joined_thread != sched->current_thread)
+        {
+	    /* re-enable preemption since return early */
+            preempt_enable();
+            return FAILURE; 
+	}
+
+	/* delete the item from the zombie queue */
+	queue_delete(sched->zombie_threads, thread_in_zombie);
+
+	/* main deallocates the all the queues if empty
+	 * throttled threads are made ready again into them: they all belong
+	 * to the throttled groups
+	 */
+        if(sched->current_thread->tid == 0 &&
+            queue_length(sched->ready_threads) == 0 &&
+            pqueue_length(sched->edf_threads) == 0 &&
+	    queue_length(sched->zombie_threads) == 0 && 
+	    queue_length(sched->blocked_threads) == 0 &&
+            (!sched->throttled_groups || pqueue_length(sched->throttled_groups) == 0))
+        {
+            queue_destroy(sched->ready_threads);
+            sched->ready_threads = NULL;
+            pqueue_destroy(sched->edf_threads);
+            sched->edf_threads = NULL;
+            queue_destroy(sched->zombie_threads);
+            sched->zombie_threads = NULL;
+	    queue_destroy(sched->blocked_threads);
+            sched->blocked_threads = NULL;
+	}
+
+	/* set return value */
+	if(retval)
+	    *retval = thread_in_zombie->retval;
+
+	/* free the resources with the dead thread */
+        delete_thread(thread_in_zombie);
+	
+	/* re-enable preemption after collecting the thread */
+        preempt_enable();
+
+	return SUCCESS;
+    }
+
+    /* the thread cannot be found */ 
+    preempt_enable();
+    return FAILURE;
+}
+
+int uthread_set_deadline(uthread_t tid, unsigned long long deadline_ns)
+{
+    struct thread *t;
+    uint64_t now, ready_cycles;
+
+    sched_ensure();
+
+    /* the main thread may set a deadline before creating any thread */
+    if(!sched->current_thread)
+        uthread_setup();
+
+    if(tid >= sched->tid_counter)
+        return FAILURE;
+    t = thread_get(tid);
+
+    now = clock_ns();
+
+    /* disable preemption
+     * make sure the thread does not change state while it changes class
+     */
+    preempt_disable();
+
+    if(t->state == ZOMBIE)
+    {
+        preempt_enable();
+        return FAILURE;
+    }
+
+    /* admission, a deadline already passed cannot be met */
+    if(deadline_ns && deadline_ns <= now)
+    {
+        sched->edf_rejected++;
+        preempt_enable();
+        return FAILURE;
+    }
+
+    thread_retire_deadline(t, now);
+    if(deadline_ns)
+        sched->edf_admitted++;
+
+    /* a ready thread moves to the queue of its new class */
+    if(t->state == READY)
+    {
+        ready_cycles = t->ready_cycles;
+        thread_unready(t);
+        t->deadline = deadline_ns;
+        thread_enqueue_ready(t);
+        t->ready_cycles = ready_cycles;
+    }
+    else
+        t->deadline = deadline_ns;
+
+    preempt_enable();
+
+    return SUCCESS;
+}
+
+uthread_group_t uthread_group_create(unsigned long long budget_ns,
+    unsigned long long period_ns)
+{
+    struct uthread_group *g;
+
+    sched_ensure();
+
+    if(!budget_ns || !period_ns || !(g = calloc(1, sizeof(*g))))
+        return NULL;
+
+    /* the throttled groups are shared by all the groups of the scheduler */
+    preempt_disable();
+    if(!sched->throttled_groups)
+        sched->throttled_groups = pqueue_create();
+    preempt_enable();
+
+    g->throttled_threads = queue_create();
+    if(!sched->throttled_groups || !g->throttled_threads)
+    {
+        if(g->throttled_threads)
+            queue_destroy(g->throttled_threads);
+        free(g);
+        return NULL;
+    }
+
+    g->sched = sched;
+    g->budget = ns_to_cycles(budget_ns);
+    g->period = ns_to_cycles(period_ns);
+    g->period_start = cycles_now();
+
+    return g;
+}
+
+int uthread_group_add(uthread_group_t group, uthread_t tid)
+{
+    struct thread *t;
+    int requeue = 0;
+
+    sched_ensure();
+
+    /* the main thread can be grouped before any thread is created */
+    if(!sched->current_thread)
+        uthread_setup();
+
+    if(tid >= sched->tid_counter || (group && group->sched != sched))
+        return FAILURE;
+    t = thread_get(tid);
+
+    /* disable preemption
+     * make sure the thread does not change state while it changes group
+     */
+    preempt_disable();
+
+    if(t->state == ZOMBIE)
+    {
+        preempt_enable();
+        return FAILURE;
+    }
+
+    /* the running thread pays its previous group for the time it ran */
+    if(t == sched->current_thread)
+    {
+        if(t->group)
+            group_charge(t, cycles_now());
+        else
+        {
+            uint64_t now = cycles_now();
+
+            t->cpu_cycles += now - t->dispatch_cycles;
+            t->dispatch_cycles = now;
+        }
+    }
+
+    /* a waiting thread is queued again according to its new group */
+    if(t->state == THROTTLED)
+    {
+        queue_delete(t->group->throttled_threads, t);
+        thread_set_state(t, READY);
+        requeue = 1;
+    }
+    else if(t->state == READY)
+    {
+        thread_unready(t);
+        requeue = 1;
+    }
+
+    if(t->group)
+        t->group->threads--;
+    t->group = group;
+    if(group)
+        group->threads++;
+
+    if(requeue)
+        thread_enqueue_ready(t);
+
+    preempt_enable();
+
+    return SUCCESS;
+}
+
+int uthread_group_destroy(uthread_group_t group)
+{
+    if(!group || group->threads)
+        return FAILURE;
+
+    preempt_disable();
+    if(group->handle)
+        pqueue_remove(group->sched->throttled_groups, group->handle);
+    preempt_enable();
+
+    queue_destroy(group->throttled_threads);
+    free(group);
+
+    return SUCCESS;
+}
+
+int uthread_group_stats(uthread_group_t group, struct uthread_group_stats *stats)
+{
+    uint64_t cpu_cycles;
+
+    if(!group || !stats)
+        return FAILURE;
+
+    preempt_disable();
+    cpu_cycles = group->cpu_cycles;
+    if(sched && sched->current_thread && sched->current_thread->group == group)
+        cpu_cycles += cycles_now() - sched->current_thread->dispatch_cycles;
+    stats->throttles = group->throttles;
+    stats->threads = group->threads;
+    stats->throttled = group->throttled;
+    preempt_enable();
+
+    stats->cpu_ns = cycles_to_ns(cpu_cycles);
+
+    return SUCCESS;
+}
+
+void *uthread_arena_alloc(size_t size)
+{
+    void *block;
+
+    sched_ensure();
+
+    /* the main thread has an arena too */
+    if(!sched->current_thread)
+        uthread_setup();
+
+    /* the arena belongs to the thread, only growing it touches shared state */
+    block = arena_alloc(&sched->current_thread->arena, size);
+    if(!block && size)
+    {
+        preempt_disable();
+        block = arena_grow(&sched->current_thread->arena, &sched->arena_cache, size);
+        preempt_enable();
+    }
+
+    return block;
+}
+
+void uthread_arena_reset(void)
+{
+    sched_ensure();
+
+    if(!sched->current_thread)
+        return;
+
+    preempt_disable();
+    arena_release(&sched->current_thread->arena, &sched->arena_cache);
+    preempt_enable();
+}
+
+/*
+ * park - Block the current thread until its address is unparked
+ * @addr: the address
+ * @expected: value @addr must hold for the thread to block
+ * @remote: whether the wake up comes from another kernel thread
+ *
+ * Return: -1 if @addr does not hold @expected, in case of failure, or if
+ * nothing could ever wake the thread up. 0 once woken up.
+ */
+static int park(int *addr, int expected, int remote)
+{
+    queue_t *bucket;
+
+    sched_ensure();
+
+    /* nobody else could wake the thread up */
+    if(!addr || (!remote && !sched->current_thread))
+        return FAILURE;
+
+    uthread_setup();
+    det_op();
+    if(remote && inbox_fd_create() == FAILURE)
+        return FAILURE;
+    bucket = park_bucket(addr);
+
+    /* disable preemption
+     * make sure the value cannot change between the check and blocking,
+     * otherwise the wake up could be missed
+     */
+    preempt_disable();
+
+    if(__atomic_load_n(addr, __ATOMIC_ACQUIRE) != expected ||
+        (!*bucket && !(*bucket = queue_create())))
+    {
+        preempt_enable();
+        return FAILURE;
+    }
+
+    TRACE(&sched->trace, TRACE_PARK, sched->current_thread->tid, 0);
+    sched->current_thread->park_addr = addr;
+    queue_enqueue_handle(*bucket, sched->current_thread, &sched->current_thread->park_handle);
+    thread_block(sched->current_thread);
+    sched->remote_parked += remote;
+
+    /* re-enable preemption after registering in the wait list */
+    preempt_enable();
+
+    /* yield to next thread (it should be blocked here until unparked) */
+    uthread_yield();
+
+    /* no other thread could run, the thread would never be woken up */
+    preempt_disable();
+    sched->remote_parked -= remote;
+    if(sched->current_thread->state == BLOCKED)
+    {
+        queue_remove_handle(*bucket, sched->current_thread->park_handle);
+        queue_remove_handle(sched->blocked_threads, sched->current_thread->blocked_handle);
+        thread_set_state(sched->current_thread, RUNNING);
+        preempt_enable();
+        return FAILURE;
+    }
+    preempt_enable();
+
+    return SUCCESS;
+}
+
+int uthread_park(int *addr, int expected)
+{
+    return park(addr, expected, 0);
+}
+
+int uthread_park_remote(int *addr, int expected)
+{
+    return park(addr, expected, 1);
+}
+
+int uthread_unpark(int *addr, int n)
+{
+    int woken;
+
+    sched_ensure();
+
+    if(!addr || n < 0)
+        return FAILURE;
+    det_op();
+
+    /* disable preemption
+     * make sure the wait list is not modified while walking it
+     */
+    preempt_disable();
+    woken = park_wake(addr, n);
+    preempt_enable();
+
+    return woken;
+}
+
+int uthread_future_init(uthread_future_t *future)
+{
+    if(!future)
+        return FAILURE;
+
+    future->done = 0;
+    future->value = NULL;
+    future->size = 0;
+    future->waiters = NULL;
+
+    return SUCCESS;
+}
+
+int uthread_future_complete(uthread_future_t *future, void *value, size_t size)
+{
+    queue_t waiters;
+
+    sched_ensure();
+
+    if(!future)
+        return FAILURE;
+    det_op();
+
+    /* disable preemption
+     * make sure the future is completed once, and no waiter is left behind
+     */
+    preempt_disable();
+
+    if(future->done)
+    {
+        preempt_enable();
+        return FAILURE;
+    }
+
+    future->value = value;
+    future->size = size;
+    future->done = 1;
+
+    /* the wait queue only lives while threads wait */
+    waiters = future->waiters;
+    future->waiters = NULL;
+    if(waiters)
+    {
+        thread_wake_queue(waiters);
+        queue_destroy(waiters);
+    }
+
+    preempt_enable();
+
+    return SUCCESS;
+}
+
+int uthread_await(uthread_future_t *future, void **value, size_t *size)
+{
+    sched_ensure();
+
+    /* nobody else could complete the future */
+    if(!future || (!future->done && !sched->current_thread))
+        return FAILURE;
+
+    uthread_setup();
+    det_op();
+
+    /* disable preemption
+     * make sure the future cannot complete between the check and blocking
+     */
+    preempt_disable();
+
+    if(!future->done)
+    {
+        if((!future->waiters && !(future->waiters = queue_create())) ||
+            queue_enqueue(future->waiters, sched->current_thread) == FAILURE)
+        {
+            preempt_enable();
+            return FAILURE;
+        }
+        thread_block(sched->current_thread);
+
+        /* re-enable preemption after registering in the wait queue */
+        preempt_enable();
+
+        /* yield to next thread (it should be blocked here until completion) */
+        uthread_yield();
+
+        /* no other thread could run, the future would never complete */
+        preempt_disable();
+        if(sched->current_thread->state == BLOCKED)
+        {
+            queue_delete(future->waiters, sched->current_thread);
+            queue_remove_handle(sched->blocked_threads, sched->current_thread->blocked_handle);
+            thread_set_state(sched->current_thread, RUNNING);
+            preempt_enable();
+            return FAILURE;
+        }
+    }
+
+    if(value)
+        *value = future->value;
+    if(size)
+        *size = future->size;
+    preempt_enable();
+
+    return SUCCESS;
+}
+
+uthread_chan_t uthread_chan_create(int capacity)
+{
+    struct uthread_chan *chan;
+
+    if(capacity < 0 || !(chan = calloc(1, sizeof(*chan))))
+        return NULL;
+
+    chan->capacity = capacity;
+    chan->items = capacity ? malloc(capacity * sizeof(void*)) : NULL;
+    chan->senders = queue_create();
+    chan->receivers = queue_create();
+    if((capacity && !chan->items) || !chan->senders || !chan->receivers)
+    {
+        free(chan->items);
+        queue_destroy(chan->senders);
+        queue_destroy(chan->receivers);
+        free(chan);
+        return NULL;
+    }
+
+    return chan;
+}
+
+int uthread_chan_destroy(uthread_chan_t chan)
+{
+    /* registrations are only taken out by the threads they belong to */
+    if(!chan || queue_length(chan->senders) || queue_length(chan->receivers))
+        return FAILURE;
+
+    queue_destroy(chan->senders);
+    queue_destroy(chan->receivers);
+    free(chan->items);
+    free(chan);
+
+    return SUCCESS;
+}
+
+/*
+ * waiter_take - Take the oldest registration still waiting out of a wait list
+ * @list: the wait list
+ *
+ * Registrations of selects which already fired on another case, or timed out,
+ * are dropped along the way, their threads have not run yet to take them out.
+ *
+ * Return: The registration, NULL if no thread waits
+ */
+static struct chan_waiter *waiter_take(queue_t list)
+{
+    struct chan_waiter *w;
+
+    while(queue_dequeue(list, (void**)&w) == SUCCESS)
+    {
+        w->handle = NULL;
+        if(w->wait->fired == -1)
+            return w;
+    }
+
+    return NULL;
+}
+
+/*
+ * waiter_fire - Complete the select of a registration with its case
+ * @w: the registration, taken out of its wait list
+ * @value: value received by the case (ignored for a send case)
+ * @ok: 0 if the channel was closed, 1 otherwise
+ */
+static void waiter_fire(struct chan_waiter *w, void *value, int ok)
+{
+    struct select_wait *wait = w->wait;
+    struct uthread_select_case *c = &wait->cases[w->index];
+
+    if(c->op == UTHREAD_SELECT_RECV)
+        c->value = value;
+    c->ok = ok;
+    wait->fired = w->index;
+    if(wait->timer)
+    {
+        pqueue_remove(sched->timers, wait->timer);
+        wait->timer = NULL;
+    }
+    thread_wake(wait->thread);
+}
+
+/*
+ * case_try - Complete a select case if it does not need to wait
+ * @c: the case
+ *
+ * Must be called with preemption disabled.
+ *
+ * Return: 1 if the case completed, 0 if it would block. -1 if it sends on a
+ * closed channel.
+ */
+static int case_try(struct uthread_select_case *c)
+{
+    struct uthread_chan *chan = c->chan;
+    struct chan_waiter *w;
+
+    if(c->op == UTHREAD_SELECT_RECV)
+    {
+        if(chan->length)
+        {
+            c->value = chan->items[chan->head];
+            chan->head = (chan->head + 1) % chan->capacity;
+            chan->length--;
+
+            /* the oldest blocked sender can now buffer its value */
+            if((w = waiter_take(chan->senders)))
+            {
+                chan->items[(chan->head + chan->length++) % chan->capacity] =
+                    w->wait->cases[w->index].value;
+                waiter_fire(w, NULL, 1);
+            }
+        }
+        else if((w = waiter_take(chan->senders)))
+        {
+            /* rendezvous with a blocked sender */
+            c->value = w->wait->cases[w->index].value;
+            waiter_fire(w, NULL, 1);
+        }
+        else if(chan->closed)
+        {
+            c->value = NULL;
+            c->ok = 0;
+            return 1;
+        }
+        else
+            return 0;
+
+        c->ok = 1;
+        return 1;
+    }
+
+    if(chan->closed)
+        return FAILURE;
+
+    if((w = waiter_take(chan->receivers)))
+        waiter_fire(w, c->value, 1);
+    else if(chan->length < chan->capacity)
+        chan->items[(chan->head + chan->length++) % chan->capacity] = c->value;
+    else
+        return 0;
+
+    c->ok = 1;
+    return 1;
+}
+
+/*
+ * cases_try - Complete the first select case which does not need to wait
+ * @cases: the cases
+ * @n: number of cases
+ *
+ * Cases are tried starting from a different one every time, so that a busy
+ * channel does not starve the others. Must be called with preemption disabled.
+ *
+ * Return: The index of the completed case, n if all cases would block. -1 if
+ * a send case is on a closed channel.
+ */
+static int cases_try(struct uthread_select_case *cases, int n)
+{
+    int i, j, start, ret;
+
+    if(!n)
+        return 0;
+
+    start = sched->select_rotation++ % n;
+    for(i = 0; i < n; i++)
+    {
+        j = (start + i) % n;
+        if((ret = case_try(&cases[j])))
+            return ret == FAILURE ? FAILURE : j;
+    }
+
+    return n;
+}
+
+int uthread_select(struct uthread_select_case *cases, int n,
+    long long timeout_ns)
+{
+    struct chan_waiter inline_waiters[SELECT_INLINE], *waiters = inline_waiters;
+    struct select_wait wait;
+    queue_t list;
+    int i, ret;
+
+    sched_ensure();
+
+    if(n < 0 || (n && !cases))
+        return FAILURE;
+    for(i = 0; i < n; i++)
+        if(!cases[i].chan || (cases[i].op != UTHREAD_SELECT_SEND &&
+            cases[i].op != UTHREAD_SELECT_RECV))
+            return FAILURE;
+    det_op();
+
+    /* without other threads, only the cases ready right away can fire */
+    if(timeout_ns <= 0 && !sched->current_thread)
+    {
+        preempt_disable();
+        ret = cases_try(cases, n);
+        preempt_enable();
+        if(ret == n)
+            return timeout_ns ? FAILURE : UTHREAD_SELECT_TIMEOUT;
+        return ret;
+    }
+
+    uthread_setup();
+    if(timeout_ns > 0 && !sched->timers && !(sched->timers = pqueue_create()))
+        return FAILURE;
+    if(n > SELECT_INLINE && !(waiters = malloc(n * sizeof(*waiters))))
+        return FAILURE;
+
+    /* disable preemption
+     * make sure no case can fire between trying them all and registering
+     */
+    preempt_disable();
+
+    ret = cases_try(cases, n);
+    if(ret != n || !timeout_ns)
+    {
+        preempt_enable();
+        if(waiters != inline_waiters)
+            free(waiters);
+        return ret == n ? UTHREAD_SELECT_TIMEOUT : ret;
+    }
+
+    /* register on the wait list of every channel */
+    wait.thread = sched->current_thread;
+    wait.cases = cases;
+    wait.fired = -1;
+    wait.timer = NULL;
+    for(i = 0; i < n; i++)
+    {
+        waiters[i].wait = &wait;
+        waiters[i].index = i;
+        list = cases[i].op == UTHREAD_SELECT_SEND ? cases[i].chan->senders :
+            cases[i].chan->receivers;
+        if(queue_enqueue_handle(list, &waiters[i], &waiters[i].handle) == FAILURE)
+            break;
+    }
+    if(i < n || (timeout_ns > 0 &&
+        pqueue_push(sched->timers, clock_ns() + timeout_ns, &wait, &wait.timer) == FAILURE))
+    {
+        n = i;
+        wait.fired = FAILURE;
+    }
+    else
+    {
+        thread_block(sched->current_thread);
+
+        /* re-enable preemption after registering */
+        preempt_enable();
+
+        /* yield to next thread (it should be blocked here until a case fires) */
+        uthread_yield();
+
+        /* no other thread could run, no case would ever fire */
+        preempt_disable();
+        if(sched->current_thread->state == BLOCKED)
+        {
+            queue_remove_handle(sched->blocked_threads, sched->current_thread->blocked_handle);
+            thread_set_state(sched->current_thread, RUNNING);
+        }
+    }
+
+    /* take the losing registrations out */
+    for(i = 0; i < n; i++)
+    {
+        if(waiters[i].handle)
+        {
+            list = cases[i].op == UTHREAD_SELECT_SEND ? cases[i].chan->senders :
+                cases[i].chan->receivers;
+            queue_remove_handle(list, waiters[i].handle);
+        }
+    }
+    if(wait.timer)
+        pqueue_remove(sched->timers, wait.timer);
+
+    /* a send case fired by the channel closing failed */
+    ret = wait.fired;
+    if(ret >= 0 && cases[ret].op == UTHREAD_SELECT_SEND && !cases[ret].ok)
+        ret = FAILURE;
+    else if(ret < 0 && ret != UTHREAD_SELECT_TIMEOUT)
+        ret = FAILURE;
+
+    preempt_enable();
+
+    if(waiters != inline_waiters)
+        free(waiters);
+
+    return ret;
+}
+
+int uthread_chan_send(uthread_chan_t chan, void *value)
+{
+    struct uthread_select_case c = { chan, UTHREAD_SELECT_SEND, value, 0 };
+
+    return uthread_select(&c, 1, -1) == 0 ? SUCCESS : FAILURE;
+}
+
+int uthread_chan_recv(uthread_chan_t chan, void **value)
+{
+    struct uthread_select_case c = { chan, UTHREAD_SELECT_RECV, NULL, 0 };
+
+    if(uthread_select(&c, 1, -1) != 0 || !c.ok)
+        return FAILURE;
+
+    if(value)
+        *value = c.value;
+    return SUCCESS;
+}
+
+int uthread_chan_close(uthread_chan_t chan)
+{
+    struct chan_waiter *w;
+
+    sched_ensure();
+
+    if(!chan)
+        return FAILURE;
+    det_op();
+
+    preempt_disable();
+
+    if(chan->closed)
+    {
+        preempt_enable();
+        return FAILURE;
+    }
+    chan->closed = 1;
+
+    /* blocked senders fail, blocked receivers get nothing since the buffer
+     * is empty whenever receivers wait
+     */
+    while((w = waiter_take(chan->senders)))
+        waiter_fire(w, NULL, 0);
+    while((w = waiter_take(chan->receivers)))
+        waiter_fire(w, NULL, 0);
+
+    preempt_enable();
+
+    return SUCCESS;
+}
+
+/*
+ * gen_slot - Find where the current generator is recorded
+ *
+ * Return: Address of the generator currently run by the calling thread
+ */
+static struct uthread_gen **gen_slot(void)
+{
+    return sched->current_thread ? &sched->current_thread->gen : &sched->gen;
+}
+
+/*
+ * gen_bootstrap - Entry point of generators
+ *
+ * Runs the function of the current generator, then switches back to its
+ * consumer for good.
+ */
+static void gen_bootstrap(void)
+{
+    struct uthread_gen *gen = *gen_slot();
+
+    gen->func(gen->arg);
+
+    /* the library may have been initialized meanwhile, find the slot again */
+    gen->state = GEN_DONE;
+    *gen_slot() = gen->parent;
+    uthread_ctx_switch(&gen->ctx, &gen->caller);
+}
+
+uthread_gen_t uthread_gen_create(uthread_gen_func_t func, void *arg)
+{
+    struct uthread_gen *gen;
+
+    if(!func || !(gen = calloc(1, sizeof(*gen))))
+        return NULL;
+
+    gen->stack = uthread_ctx_alloc_stack();
+    if(!gen->stack || uthread_ctx_init_entry(&gen->ctx, gen->stack, gen_bootstrap))
+    {
+        if(gen->stack)
+            uthread_ctx_destroy_stack(gen->stack);
+        free(gen);
+        return NULL;
+    }
+    gen->func = func;
+    gen->arg = arg;
+    gen->state = GEN_NEW;
+
+    return gen;
+}
+
+int uthread_gen_next(uthread_gen_t gen, void **value)
+{
+    struct uthread_gen **slot;
+
+    sched_ensure();
+
+    if(!gen || gen->state == GEN_RUNNING || gen->state == GEN_DONE)
+        return FAILURE;
+
+    /* no preemption to disable: the generator only runs within this thread */
+    slot = gen_slot();
+    gen->parent = *slot;
+    gen->state = GEN_RUNNING;
+    *slot = gen;
+    uthread_ctx_switch(&gen->caller, &gen->ctx);
+
+    if(gen->state == GEN_DONE)
+        return FAILURE;
+    if(value)
+        *value = gen->value;
+
+    return SUCCESS;
+}
+
+int uthread_gen_yield(void *value)
+{
+    struct uthread_gen **slot, *gen;
+
+    if(!sched || !*(slot = gen_slot()))
+        return FAILURE;
+
+    gen = *slot;
+    gen->value = value;
+    gen->state = GEN_SUSPENDED;
+    *slot = gen->parent;
+    uthread_ctx_switch(&gen->ctx, &gen->caller);
+
+    return SUCCESS;
+}
+
+int uthread_gen_destroy(uthread_gen_t gen)
+{
+    if(!gen || gen->state == GEN_RUNNING)
+        return FAILURE;
+
+    uthread_ctx_destroy_stack(gen->stack);
+    free(gen);
+
+    return SUCCESS;
+}
+
+/*
+ * remote_push - Queue a request for the scheduler of another kernel thread
+ * @s: the scheduler
+ * @req: the request
+ *
+ * The inbox is a lock-free stack: any number of kernel threads push, and the
+ * scheduler takes the whole stack at once. The scheduler is only woken up if
+ * it sleeps waiting for requests.
+ */
+static void remote_push(struct uthread_sched *s, struct remote_request *req)
+{
+    uint64_t one = 1;
+
+    req->next = __atomic_load_n(&s->inbox, __ATOMIC_RELAXED);
+    while(!__atomic_compare_exchange_n(&s->inbox, &req->next, req, 1,
+        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        ;
+
+    if(__atomic_exchange_n(&s->idle, 0, __ATOMIC_SEQ_CST))
+        while(write(s->inbox_fd, &one, sizeof(one)) < 0 && errno == EINTR)
+            ;
+}
+
+int uthread_submit(uthread_sched_t s, uthread_func_t func, void *arg)
+{
+    struct remote_request *req;
+
+    if(!s || !func || !(req = malloc(sizeof(*req))))
+        return FAILURE;
+
+    req->func = func;
+    req->arg = arg;
+    remote_push(s, req);
+
+    return SUCCESS;
+}
+
+int uthread_unpark_remote(uthread_sched_t s, int *addr, int n)
+{
+    struct remote_request *req;
+
+    if(!s || !addr || n < 0 || !(req = malloc(sizeof(*req))))
+        return FAILURE;
+
+    req->func = NULL;
+    req->addr = addr;
+    req->n = n;
+    remote_push(s, req);
+
+    return SUCCESS;
+}
+
+int uthread_remote_enable(int enable)
+{
+    sched_ensure();
+
+    if(enable && inbox_fd_create() == FAILURE)
+        return FAILURE;
+    sched->remote = enable;
+
+    return SUCCESS;
+}
+
+/*
+ * stats_signal_handler - Signal handler requesting a statistics dump
+ * @signum: the signal received
+ *
+ * Dumping is not async-signal-safe, so the handler only flags the request and
+ * the dump happens at the next scheduling point.
+ */
+static void stats_signal_handler(int signum)
+{
+    __atomic_fetch_add(&stats_dump_requests, 1, __ATOMIC_RELAXED);
+}
+
+void uthread_stats_enable(int enable)
+{
+    uint64_t now = enable ? clock_ns() : 0;
+    int i;
+
+    sched_ensure();
+
+    preempt_disable();
+
+    /* restart the clock of every thread so no stale interval gets charged */
+    for(i = 0; i < sched->tid_counter; i++)
+        thread_get(i)->state_since = now;
+    sched->stats_timed = enable;
+
+    preempt_enable();
+}
+
+/*
+ * thread_cpu_cycles - Get the run time of a thread
+ * @t: the thread
+ * @now: current cycle count
+ *
+ * Return: Number of cycles @t spent running, including the current slice if
+ * it is running
+ */
+static uint64_t thread_cpu_cycles(struct thread *t, uint64_t now)
+{
+    if(t == sched->current_thread)
+        return t->cpu_cycles + now - t->dispatch_cycles;
+    return t->cpu_cycles;
+}
+
+int uthread_stats(struct uthread_stats *stats)
+{
+    uint64_t cpu_cycles = 0, now;
+    int i;
+
+    sched_ensure();
+
+    if(!stats)
+        return FAILURE;
+
+    memset(stats, 0, sizeof(*stats));
+
+    preempt_disable();
+
+    /* the global counters are the sum of the per-thread ones */
+    now = cycles_now();
+    for(i = 0; i < sched->tid_counter; i++)
+    {
+        cpu_cycles += thread_cpu_cycles(thread_get(i), now);
+        stats->switches += thread_get(i)->stats.switches;
+        stats->voluntary += thread_get(i)->stats.voluntary;
+        stats->preempted += thread_get(i)->stats.preempted;
+        stats->run_ns += thread_get(i)->stats.run_ns;
+        stats->wait_ns += thread_get(i)->stats.wait_ns;
+        stats->join_ns += thread_get(i)->stats.join_ns;
+    }
+    stats->threads = sched->tid_counter;
+    stats->stacks = sched->stack_count;
+
+    /* queues do not exist before the first thread creation */
+    stats->ready = sched->ready_threads ? queue_length(sched->ready_threads) : 0;
+    stats->ready += sched->edf_threads ? pqueue_length(sched->edf_threads) : 0;
+    stats->deadlines = sched->edf_admitted;
+    stats->rejected = sched->edf_rejected;
+    stats->overruns = sched->edf_overruns;
+    stats->ticks = sched->ticks;
+    stats->ticks_skipped = sched->ticks_skipped;
+    stats->blocked = sched->blocked_threads ? queue_length(sched->blocked_threads) : 0;
+    stats->zombie = sched->zombie_threads ? queue_length(sched->zombie_threads) : 0;
+
+    preempt_enable();
+
+    stats->cpu_ns = cycles_to_ns(cpu_cycles);
+
+    return SUCCESS;
+}
+
+int uthread_thread_stats(uthread_t tid, struct uthread_thread_stats *stats)
+{
+    uint64_t cpu_cycles;
+
+    sched_ensure();
+
+    /* TIDs are never reused so any TID ever handed out can be queried */
+    if(!stats || tid >= sched->tid_counter)
+        return FAILURE;
+
+    preempt_disable();
+    *stats = thread_get(tid)->stats;
+    cpu_cycles = thread_cpu_cycles(thread_get(tid), cycles_now());
+    preempt_enable();
+
+    stats->cpu_ns = cycles_to_ns(cpu_cycles);
+
+    return SUCCESS;
+}
+
+void uthread_stats_dump(int fd)
+{
+    struct uthread_stats stats;
+    int i;
+
+    uthread_stats(&stats);
+    dprintf(fd, "uthread: %d threads, %llu switches (%llu voluntary, "
+        "%llu preempted), ready %d, blocked %d, zombie %d\n",
+        stats.threads, stats.switches, stats.voluntary, stats.preempted,
+        stats.ready, stats.blocked, stats.zombie);
+    dprintf(fd, "uthread: run %llu ns, wait %llu ns, join %llu ns\n",
+        stats.run_ns, stats.wait_ns, stats.join_ns);
+    dprintf(fd, "uthread: deadlines %llu admitted, %llu rejected, %llu overruns\n",
+        stats.deadlines, stats.rejected, stats.overruns);
+    dprintf(fd, "uthread: cpu %llu ns, %llu ticks (%llu within slice)\n",
+        stats.cpu_ns, stats.ticks, stats.ticks_skipped);
+
+    for(i = 0; i < sched->tid_counter; i++)
+    {
+        struct uthread_thread_stats t;
+
+        uthread_thread_stats(i, &t);
+        dprintf(fd, "  tid %d: %llu switches (%llu voluntary, %llu preempted), "
+            "run %llu ns, wait %llu ns, join %llu ns, cpu %llu ns\n", i,
+            t.switches, t.voluntary, t.preempted, t.run_ns, t.wait_ns,
+            t.join_ns, t.cpu_ns);
+    }
+}
+
+int uthread_stats_dump_on(int signum, int fd)
+{
+    struct sigaction sa;
+
+    /* the preemption signal is already taken by the scheduler */
+    if(signum == SIGVTALRM)
+        return FAILURE;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = stats_signal_handler;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+
+    stats_dump_fd = fd;
+    return sigaction(signum, &sa, NULL) ? FAILURE : SUCCESS;
+}
+
+void uthread_stack_profile_enable(int enable)
+{
+    sched_ensure();
+
+    preempt_disable();
+    uthread_ctx_paint_stacks(enable);
+    sched->stack_profiling = enable;
+    preempt_enable();
+}
+
+int uthread_stack_profile(struct uthread_stack_usage *usage, int n)
+{
+    int i, count = 0;
+
+    sched_ensure();
+
+    if(n < 0 || (n && !usage))
+        return FAILURE;
+
+    preempt_disable();
+    for(i = 0; i <= STACK_PROFILE_SIZE && count < n; i++)
+    {
+        struct stack_profile *p = &sched->stack_profiles[i];
+
+        /* unused entries, except the overflow one which may be filled */
+        if(!p->threads)
+            continue;
+
+        usage[count].func = p->func;
+        usage[count].threads = p->threads;
+        usage[count].max_bytes = p->max_bytes;
+        usage[count].mean_bytes = p->total_bytes / p->threads;
+        count++;
+    }
+    preempt_enable();
+
+    return count;
+}
+
+void uthread_stack_profile_dump(int fd)
+{
+    struct uthread_stack_usage usage[STACK_PROFILE_SIZE + 1];
+    int i, count;
+
+    count = uthread_stack_profile(usage, STACK_PROFILE_SIZE + 1);
+    dprintf(fd, "uthread: stack usage of %d functions, %ld bytes per stack\n",
+        count, uthread_ctx_stack_size());
+    for(i = 0; i < count; i++)
+    {
+        if(usage[i].func)
+            dprintf(fd, "  func %p: ", (void*)usage[i].func);
+        else
+            dprintf(fd, "  other functions: ");
+        dprintf(fd, "%lu threads, max %lu bytes, mean %lu bytes\n",
+            usage[i].threads, usage[i].max_bytes, usage[i].mean_bytes);
+    }
+}
+
+int uthread_latency(struct uthread_latency *lat)
+{
+    uint64_t count, sum, min, max, p50, p99, p999;
+
+    sched_ensure();
+
+    if(!lat)
+        return FAILURE;
+
+    /* sample the histogram atomically, convert outside the critical section */
+    preempt_disable();
+    count = sched->ready_latency.count;
+    sum = sched->ready_latency.sum;
+    min = sched->ready_latency.min;
+    max = sched->ready_latency.max;
+    p50 = hist_percentile(&sched->ready_latency, 50.0);
+    p99 = hist_percentile(&sched->ready_latency, 99.0);
+    p999 = hist_percentile(&sched->ready_latency, 99.9);
+    preempt_enable();
+
+    lat->count = count;
+    lat->min_ns = cycles_to_ns(min);
+    lat->max_ns = cycles_to_ns(max);
+    lat->mean_ns = count ? cycles_to_ns(sum / count) : 0;
+    lat->p50_ns = cycles_to_ns(p50);
+    lat->p99_ns = cycles_to_ns(p99);
+    lat->p999_ns = cycles_to_ns(p999);
+
+    return SUCCESS;
+}
+
+unsigned long long uthread_latency_percentile(double percentile)
+{
+    uint64_t value;
+
+    sched_ensure();
+
+    preempt_disable();
+    value = hist_percentile(&sched->ready_latency, percentile);
+    preempt_enable();
+
+    return cycles_to_ns(value);
+}
+
+void uthread_latency_reset(void)
+{
+    sched_ensure();
+
+    preempt_disable();
+    hist_reset(&sched->ready_latency);
+    preempt_enable();
+}
@@ -1,14 +1,17 @@
 #ifndef _UTHREAD_H
 #define _UTHREAD_H
 
+#include <stddef.h>
+
 /*
  * uthread_t - Thread identifier (TID) type
  *
- * Each user thread is assigned a different TID. TID are assigned in increasing
- * order and numbered starting from 1 (apart from the 'main' thread who
- * automatically gets TID #0). Overflowing the current TID value is considered a
- * case of failure (in other words, it is impossible to create more than
- * USHRT_MAX threads).
+ * Each user thread is assigned a different TID within its scheduler (see
+ * uthread_sched_t). TID are assigned in increasing order and numbered starting
+ * from 1 (apart from the 'main' thread who automatically gets TID #0).
+ * Overflowing the current TID value is considered a case of failure (in other
+ * words, it is impossible to create more than USHRT_MAX threads per
+ * scheduler).
  */
 typedef unsigned short uthread_t;
 
@@ -20,6 +23,60 @@ typedef unsigned short uthread_t;
  */
 typedef int (*uthread_func_t)(void *arg);
 
+/*
+ * uthread_sched_t - Scheduler type
+ *
+ * A scheduler owns a set of threads along with everything they use (queues,
+ * TCBs, stacks, statistics). Each kernel thread (pthread) runs at most one
+ * scheduler, and every function of this API acts on the scheduler of the
+ * calling kernel thread: TIDs, statistics and settings are per scheduler, and
+ * threads of different schedulers cannot join or yield to each other.
+ *
+ * The first kernel thread to use the library gets a default scheduler, and
+ * any other kernel thread using it without attaching a scheduler first gets a
+ * scheduler of its own.
+ */
+typedef struct uthread_sched* uthread_sched_t;
+
+/*
+ * uthread_sched_create - Create a scheduler
+ *
+ * Return: The new scheduler, not attached to any kernel thread yet. NULL in
+ * case of memory allocation failure.
+ */
+uthread_sched_t uthread_sched_create(void);
+
+/*
+ * uthread_sched_attach - Make a scheduler the one of the calling kernel thread
+ * @sched: Scheduler to attach
+ *
+ * The calling kernel thread becomes the main thread (TID #0) of @sched.
+ *
+ * Return: -1 if @sched is NULL or already attached, or if the calling kernel
+ * thread already has a scheduler. 0 otherwise.
+ */
+int uthread_sched_attach(uthread_sched_t sched);
+
+/*
+ * uthread_sched_self - Get the scheduler of the calling kernel thread
+ *
+ * Return: The scheduler of the calling kernel thread, NULL if it has none yet
+ */
+uthread_sched_t uthread_sched_self(void);
+
+/*
+ * uthread_sched_destroy - Deallocate a scheduler
+ * @sched: Scheduler to deallocate
+ *
+ * If @sched is attached, it must be attached to the calling kernel thread and
+ * called from its main thread. The kernel thread is then left without
+ * scheduler. All the threads of @sched must have been collected.
+ *
+ * Return: -1 if @sched is NULL, is the default scheduler, is attached to
+ * another kernel thread, or still has threads. 0 if @sched was deallocated.
+ */
+int uthread_sched_destroy(uthread_sched_t sched);
+
 /*
  * uthread_create - Create a new thread
  * @func: Function to be executed by the thread
@@ -28,11 +85,35 @@ typedef int (*uthread_func_t)(void *arg);
  * This function creates a new thread running the function @func to which
  * argument @arg is passed, and returns the TID of this new thread.
  *
- * Return: -1 in case of failure (memory allocation, context creation, TID
- * overflow, etc.). The TID of the new thread otherwise.
+ * The stack and execution context of the thread are only set up when the
+ * thread is scheduled for the first time, reusing the stack of an exited
+ * thread when possible. If they cannot be set up at that point, the thread
+ * exits right away with -1 as return value.
+ *
+ * Return: -1 in case of failure (memory allocation, TID overflow, etc.). The
+ * TID of the new thread otherwise.
  */
 int uthread_create(uthread_func_t func, void *arg);
 
+/*
+ * uthread_create_n - Create several threads at once
+ * @func: Function to be executed by the threads
+ * @args: (Optional) Array of @n arguments, the i-th being passed to the i-th
+ *	thread. If NULL, every thread receives NULL.
+ * @n: Number of threads to create
+ * @tids: (Optional) Array of @n TIDs receiving the TIDs of the new threads
+ *
+ * This function is equivalent to @n calls to uthread_create() but the threads
+ * are set up in a single critical section and queued in bulk. The threads are
+ * scheduled in creation order.
+ *
+ * Either all the threads are created or none is.
+ *
+ * Return: -1 if @func is NULL, if @n is not positive, or in case of failure
+ * (memory allocation, TID overflow, etc.). @n otherwise.
+ */
+int uthread_create_n(uthread_func_t func, void **args, int n, uthread_t *tids);
+
 /*
  * uthread_self - Get thread identifier
  *
@@ -48,6 +129,114 @@ uthread_t uthread_self(void);
  */
 void uthread_yield(void);
 
+/*
+ * uthread_yield_to - Yield execution to a specific thread
+ * @tid: TID of the thread to run next
+ *
+ * This function is to be called from the currently active and running thread
+ * in order to switch directly to thread @tid, ahead of the other ready
+ * threads. The calling thread is put back in the ready queue like with
+ * uthread_yield(), and thread @tid runs for the remainder of the caller's
+ * time slice.
+ *
+ * If thread @tid is not ready to run (blocked, exited, the caller itself or
+ * unknown), this function behaves like uthread_yield().
+ *
+ * Return: 0 if execution was handed off to thread @tid. -1 if it was not
+ * ready and a regular yield was performed instead.
+ */
+int uthread_yield_to(uthread_t tid);
+
+/*
+ * uthread_set_timeslice - Configure the preemption time slices
+ * @min_ns: Shortest time slice
+ * @max_ns: Longest time slice
+ * @period_ns: Scheduling period
+ *
+ * A thread which starts running gets a time slice equal to the scheduling
+ * period divided by the number of runnable threads, bounded by @min_ns and
+ * @max_ns: slices get shorter as more threads wait, so that every one of them
+ * runs within about a period, and longer as fewer threads wait, to save on
+ * switches. The preemption timer only switches out threads which used up
+ * their slice. Setting @min_ns and @max_ns to the same value gives a fixed
+ * quantum.
+ *
+ * Defaults are 1 ms, 10 ms and 20 ms respectively. The timer ticks every
+ * millisecond of process CPU time, which limits the precision of slices.
+ *
+ * Return: -1 if @min_ns is 0 or larger than @max_ns. 0 otherwise.
+ */
+int uthread_set_timeslice(unsigned long long min_ns, unsigned long long max_ns,
+			  unsigned long long period_ns);
+
+/*
+ * uthread_det_enable - Make the schedule of the scheduler reproducible
+ * @seed: Seed of the pseudo-random choices of the schedule
+ * @quantum: Number of scheduling operations after which the running thread is
+ *	preempted, 0 to only switch threads when they block or yield
+ *
+ * In deterministic mode, the preemption timer no longer switches threads, as
+ * it lands at arbitrary instructions. Instead, the running thread is
+ * preempted once it performed @quantum scheduling operations since it was
+ * switched to. Scheduling operations are thread creations, parking and
+ * unparking, futures, channel operations, and explicit points marked with
+ * uthread_det_point(). The next thread to run is drawn among the ready
+ * threads by a generator seeded with @seed, rather than taken in FIFO order
+ * (threads with a deadline and directed handoffs keep precedence).
+ *
+ * The same program with the same seed then goes through the same schedule, as
+ * long as it does not depend on time (timeouts, deadlines, thread groups) or
+ * on other kernel threads. Every switch is recorded, see uthread_det_trace().
+ * Enabling again restarts the recording and the generator.
+ */
+void uthread_det_enable(unsigned long long seed, unsigned int quantum);
+
+/*
+ * uthread_det_disable - Go back to timer preemption and FIFO scheduling
+ *
+ * The recorded schedule stays available until deterministic mode is enabled
+ * again.
+ */
+void uthread_det_disable(void);
+
+/*
+ * uthread_det_point - Mark a scheduling point in deterministic mode
+ *
+ * Counts as a scheduling operation, which may preempt the calling thread.
+ * Placed in loops which do not call the library otherwise, so that they can
+ * be preempted. Does nothing outside of deterministic mode.
+ */
+void uthread_det_point(void);
+
+/*
+ * uthread_det_trace - Get the recorded schedule
+ * @trace: Array receiving the TIDs of the threads switched to, in order
+ * @n: Size of @trace
+ *
+ * Return: -1 if @n is negative, or if @trace is NULL with @n positive. The
+ * number of switches recorded since deterministic mode was enabled otherwise,
+ * which may be larger than @n (only the first @n are copied).
+ */
+int uthread_det_trace(uthread_t *trace, int n);
+
+/*
+ * uthread_det_replay - Replay a recorded schedule
+ * @trace: TIDs of the threads to switch to, as given by uthread_det_trace()
+ * @n: Number of switches in @trace
+ *
+ * The next @n switches go to the threads of @trace instead of random ones,
+ * for instance to run a modified program through the schedule recorded from
+ * the original one. TIDs being assigned in creation order, @trace is
+ * typically replayed from the start of a new process or scheduler. If the
+ * program diverges, the replay stops at the first switch which differs and
+ * the rest of the schedule is drawn at random.
+ *
+ * Return: -1 if deterministic mode is not enabled, if @n is negative, if
+ * @trace is NULL with @n positive, or in case of memory allocation failure.
+ * 0 otherwise.
+ */
+int uthread_det_replay(const uthread_t *trace, int n);
+
 /*
  * uthread_exit - Exit from currently running thread
  * @retval: Return value
@@ -57,8 +246,8 @@ void uthread_yield(void);
  * from a joining thread.
  *
  * A thread which has not been 'collected' should stay in a zombie state. This
- * means that until collection, the resources associated to a zombie thread
- * should not be freed.
+ * means that until collection, the return value of a zombie thread is kept.
+ * Its stack is however reclaimed as soon as another thread runs.
  *
  * This function shall never return.
  */
@@ -81,4 +270,623 @@ void uthread_exit(int retval);
  */
 int uthread_join(uthread_t tid, int *retval);
 
+/*
+ * uthread_park - Block on an address until woken up
+ * @addr: Address of the word to wait on
+ * @expected: Value @addr is expected to hold
+ *
+ * This function atomically checks that the integer at @addr still holds
+ * @expected and, if so, blocks the calling thread until another thread calls
+ * uthread_unpark() on the same address. Nothing is allocated per address:
+ * parked threads are kept in a fixed table of wait lists indexed by a hash of
+ * @addr, so any integer can be waited on.
+ *
+ * Since the value may have changed again by the time the thread is woken up,
+ * callers are expected to re-check their condition and park again if needed.
+ *
+ * Return: 0 after being woken up. -1 if the integer at @addr did not hold
+ * @expected, if @addr is NULL, or if no other thread was left to run and wake
+ * the caller up.
+ */
+int uthread_park(int *addr, int expected);
+
+/*
+ * uthread_unpark - Wake up threads parked on an address
+ * @addr: Address the threads are parked on
+ * @n: Maximum number of threads to wake up
+ *
+ * This function makes up to @n threads blocked in uthread_park() on @addr
+ * ready again, in the order they were parked. Use INT_MAX to wake up all of
+ * them.
+ *
+ * Return: The number of threads woken up, -1 if @addr is NULL or @n is
+ * negative.
+ */
+int uthread_unpark(int *addr, int n);
+
+/*
+ * uthread_future_t - Future type
+ *
+ * A future holds a result which is not known yet. Any thread can complete the
+ * future once, and any number of threads can wait for it, before or after it
+ * completed. The result is a pointer along with a size, whose meaning is up to
+ * the threads sharing the future (the memory pointed to is not copied).
+ *
+ * A future is a plain structure which does not need to be destroyed. It can
+ * only be used by the threads of one scheduler.
+ */
+typedef struct {
+	int done;		/* set once completed */
+	void *value;		/* result */
+	size_t size;		/* size of the result */
+	void *waiters;		/* threads waiting for completion (internal) */
+} uthread_future_t;
+
+/*
+ * uthread_future_init - Initialize a future
+ * @future: Future to initialize
+ *
+ * Return: -1 if @future is NULL. 0 otherwise.
+ */
+int uthread_future_init(uthread_future_t *future);
+
+/*
+ * uthread_future_complete - Complete a future
+ * @future: Future to complete
+ * @value: Result
+ * @size: Size of the result
+ *
+ * All the threads waiting for @future are made ready at once, in the order
+ * they started waiting.
+ *
+ * Return: -1 if @future is NULL or was already completed. 0 otherwise.
+ */
+int uthread_future_complete(uthread_future_t *future, void *value, size_t size);
+
+/*
+ * uthread_await - Wait for a future to complete
+ * @future: Future to wait for
+ * @value: (Optional) Address of a pointer receiving the result
+ * @size: (Optional) Address of a size receiving the size of the result
+ *
+ * Return right away if @future already completed, block the calling thread
+ * until it does otherwise.
+ *
+ * Return: -1 if @future is NULL, in case of memory allocation failure, or if
+ * no other thread was left to run and complete @future. 0 otherwise.
+ */
+int uthread_await(uthread_future_t *future, void **value, size_t *size);
+
+/*
+ * uthread_chan_t - Channel type
+ *
+ * A channel passes pointers from sending threads to receiving threads, in the
+ * order they were sent. A channel buffers up to a fixed number of values:
+ * senders only block when the buffer is full, and receivers when it is empty.
+ * Without buffer, a sender blocks until a receiver takes its value.
+ *
+ * A channel can only be used by the threads of one scheduler.
+ */
+typedef struct uthread_chan* uthread_chan_t;
+
+/*
+ * uthread_chan_create - Create a channel
+ * @capacity: Number of values buffered (0 for none)
+ *
+ * Return: The new channel. NULL if @capacity is negative, or in case of
+ * memory allocation failure.
+ */
+uthread_chan_t uthread_chan_create(int capacity);
+
+/*
+ * uthread_chan_destroy - Deallocate a channel
+ * @chan: Channel to deallocate
+ *
+ * Values still buffered are dropped.
+ *
+ * Return: -1 if @chan is NULL or if threads wait on it. 0 otherwise.
+ */
+int uthread_chan_destroy(uthread_chan_t chan);
+
+/*
+ * uthread_chan_close - Close a channel
+ * @chan: Channel to close
+ *
+ * No value can be sent on a closed channel. Values already buffered can still
+ * be received, after which receiving fails right away. Blocked senders and
+ * receivers are woken up and fail.
+ *
+ * Return: -1 if @chan is NULL or already closed. 0 otherwise.
+ */
+int uthread_chan_close(uthread_chan_t chan);
+
+/*
+ * uthread_chan_send - Send a value on a channel
+ * @chan: Channel to send on
+ * @value: Value to send
+ *
+ * Block until @value is buffered or taken by a receiver.
+ *
+ * Return: -1 if @chan is NULL or closed, or if no other thread was left to
+ * run and receive. 0 otherwise.
+ */
+int uthread_chan_send(uthread_chan_t chan, void *value);
+
+/*
+ * uthread_chan_recv - Receive a value from a channel
+ * @chan: Channel to receive from
+ * @value: (Optional) Address of a pointer receiving the value
+ *
+ * Block until a value is available.
+ *
+ * Return: -1 if @chan is NULL, closed with no value left, or if no other
+ * thread was left to run and send. 0 otherwise.
+ */
+int uthread_chan_recv(uthread_chan_t chan, void **value);
+
+/* Operations of select cases */
+#define UTHREAD_SELECT_SEND 0
+#define UTHREAD_SELECT_RECV 1
+
+/* Value returned by uthread_select() when no case fired in time */
+#define UTHREAD_SELECT_TIMEOUT (-2)
+
+/*
+ * struct uthread_select_case - Channel operation of a select
+ */
+struct uthread_select_case {
+	uthread_chan_t chan;	/* channel to operate on */
+	int op;			/* UTHREAD_SELECT_SEND or UTHREAD_SELECT_RECV */
+	void *value;		/* value to send, or value received */
+	int ok;			/* set when the case fires: 0 if a receive
+				   found the channel closed, 1 otherwise */
+};
+
+/*
+ * uthread_select - Perform the first channel operation which can proceed
+ * @cases: Channel operations to choose from
+ * @n: Number of cases
+ * @timeout_ns: Time to wait for a case in nanoseconds. 0 returns right away
+ *	if no case can proceed (like a default case), and a negative value
+ *	waits as long as needed.
+ *
+ * If some cases can proceed right away, one of them is performed, starting
+ * from a different case at every call for fairness. Otherwise the calling
+ * thread waits on all the channels at once, until exactly one case is
+ * performed by another thread or the timeout expires. A receive case on a
+ * closed channel proceeds with @ok set to 0.
+ *
+ * Return: The index of the case performed. UTHREAD_SELECT_TIMEOUT if no case
+ * could proceed in time. -1 if @cases is invalid, if a send case is on a
+ * closed channel, in case of memory allocation failure, or if no other thread
+ * was left to run and fire a case.
+ */
+int uthread_select(struct uthread_select_case *cases, int n,
+	long long timeout_ns);
+
+/*
+ * uthread_gen_t - Generator type
+ *
+ * A generator runs a function on a stack of its own, which hands values one
+ * at a time to the thread advancing it. Control goes straight from the
+ * consumer to the generator and back: the scheduler, its ready queue and the
+ * preemption timer are not involved, and the generator runs as part of the
+ * consumer thread (a preempted generator resumes with that thread).
+ *
+ * A generator can be advanced by any thread of its scheduler, one at a time,
+ * and can itself advance other generators.
+ */
+typedef struct uthread_gen* uthread_gen_t;
+
+/*
+ * uthread_gen_func_t - Generator function type
+ * @arg: Argument to be passed to the generator
+ *
+ * The generator is done once the function returns. It must not call
+ * uthread_exit().
+ */
+typedef void (*uthread_gen_func_t)(void *arg);
+
+/*
+ * uthread_gen_create - Create a generator
+ * @func: Function producing the values
+ * @arg: Argument to be passed to @func
+ *
+ * @func only starts running at the first call to uthread_gen_next().
+ *
+ * Return: The new generator. NULL if @func is NULL, or in case of memory
+ * allocation failure.
+ */
+uthread_gen_t uthread_gen_create(uthread_gen_func_t func, void *arg);
+
+/*
+ * uthread_gen_next - Get the next value of a generator
+ * @gen: Generator to advance
+ * @value: (Optional) Address of a pointer receiving the value
+ *
+ * Run @gen until it yields a value or returns.
+ *
+ * Return: 0 if @gen yielded a value. -1 if @gen is NULL, currently running,
+ * or done (its function returned).
+ */
+int uthread_gen_next(uthread_gen_t gen, void **value);
+
+/*
+ * uthread_gen_yield - Hand a value to the consumer of the current generator
+ * @value: Value to hand over
+ *
+ * Suspend the calling generator until the next call to uthread_gen_next().
+ *
+ * Return: -1 if not called from a generator. 0 otherwise.
+ */
+int uthread_gen_yield(void *value);
+
+/*
+ * uthread_gen_destroy - Deallocate a generator
+ * @gen: Generator to deallocate
+ *
+ * A generator can be destroyed before it is done: its function never resumes,
+ * so it must not hold resources across uthread_gen_yield().
+ *
+ * Return: -1 if @gen is NULL or currently running. 0 otherwise.
+ */
+int uthread_gen_destroy(uthread_gen_t gen);
+
+/*
+ * uthread_submit - Create a thread from another kernel thread
+ * @sched: Scheduler running the new thread
+ * @func: Function to be executed by the thread
+ * @arg: Argument to be passed to the thread
+ *
+ * This function can be called from any kernel thread, including ones which
+ * do not use the library (e.g. callbacks of other threading libraries), and
+ * never blocks. The request is served by @sched at its next scheduling point:
+ * the thread is created then, and is collected on its own when it exits (it
+ * cannot be joined). The request is dropped if the thread cannot be created.
+ *
+ * @sched must not be destroyed while requests may still be sent to it.
+ *
+ * Return: -1 if @sched or @func are NULL, or in case of memory allocation
+ * failure. 0 if the request was sent.
+ */
+int uthread_submit(uthread_sched_t sched, uthread_func_t func, void *arg);
+
+/*
+ * uthread_unpark_remote - Wake up parked threads from another kernel thread
+ * @sched: Scheduler of the parked threads
+ * @addr: Address the threads are parked on
+ * @n: Maximum number of threads to wake up
+ *
+ * Like uthread_unpark(), but can be called from any kernel thread. The
+ * threads are woken up by @sched at its next scheduling point. The word at
+ * @addr must be changed (atomically) before the call so that threads about to
+ * park do not miss the wake up.
+ *
+ * Return: -1 if @sched or @addr are NULL, if @n is negative, or in case of
+ * memory allocation failure. 0 if the request was sent.
+ */
+int uthread_unpark_remote(uthread_sched_t sched, int *addr, int n);
+
+/*
+ * uthread_park_remote - Park until another kernel thread unparks the thread
+ * @addr: Address to park on
+ * @expected: Value @addr must hold for the thread to park
+ *
+ * Like uthread_park(), but the wake up is expected to come from another
+ * kernel thread through uthread_unpark_remote(). If no other thread can run
+ * meanwhile, the kernel thread sleeps until it does rather than reporting a
+ * deadlock. Can be called from the main thread before any thread was created.
+ *
+ * Return: -1 if @addr is NULL, if it does not hold @expected, or if the
+ * eventfd waking the kernel thread cannot be created. 0 once woken up (which
+ * may be spurious, the caller must check @addr again).
+ */
+int uthread_park_remote(int *addr, int expected);
+
+/*
+ * uthread_remote_enable - Wait for other kernel threads when all are blocked
+ * @enable: Non-zero to wait, 0 to report deadlocks
+ *
+ * By default, when all the threads are blocked, joining or parking fails as
+ * nothing could ever wake them up. While enabled, the kernel thread instead
+ * sleeps on an eventfd until another kernel thread submits a thread or
+ * unparks one (see uthread_submit() and uthread_unpark_remote()).
+ *
+ * Return: -1 if the eventfd cannot be created, 0 otherwise
+ */
+int uthread_remote_enable(int enable);
+
+/*
+ * uthread_set_deadline - Set the deadline of a thread
+ * @tid: TID of the thread
+ * @deadline_ns: Absolute deadline, in nanoseconds on the CLOCK_MONOTONIC
+ *	clock, or 0 to make the thread best effort again
+ *
+ * Threads with a deadline are scheduled earliest deadline first (EDF), ahead
+ * of every best-effort thread: as long as a thread with a deadline is ready, no
+ * best-effort thread runs. Best-effort threads are scheduled in FIFO order.
+ *
+ * A deadline is met if the thread exits or sets another deadline (or 0) before
+ * it passes. Missed deadlines are counted as overruns in the statistics.
+ *
+ * Return: -1 if thread @tid cannot be found or has exited, or if
+ * @deadline_ns has already passed (the deadline is then rejected and the
+ * thread keeps its previous one). 0 otherwise.
+ */
+int uthread_set_deadline(uthread_t tid, unsigned long long deadline_ns);
+
+/*
+ * uthread_group_t - Thread group type
+ *
+ * A thread group shares a CPU budget among its threads: in every period, the
+ * threads of the group run for at most the budget in total. Once the budget
+ * is spent, the group is throttled: its threads are taken out of the ready
+ * queue and only run again once the next period starts. Run time is charged
+ * at every scheduling point, and the time slice of a thread of a group never
+ * extends past the budget left to the group.
+ *
+ * A group can only contain threads of the scheduler it was created by.
+ */
+typedef struct uthread_group* uthread_group_t;
+
+/*
+ * uthread_group_create - Create a thread group
+ * @budget_ns: CPU time the threads of the group can use per period
+ * @period_ns: Length of the period
+ *
+ * Return: The new group. NULL if @budget_ns or @period_ns is 0, or in case of
+ * memory allocation failure.
+ */
+uthread_group_t uthread_group_create(unsigned long long budget_ns,
+	unsigned long long period_ns);
+
+/*
+ * uthread_group_add - Move a thread into a group
+ * @group: Group to move the thread into, NULL to take it out of its group
+ * @tid: TID of the thread
+ *
+ * The thread leaves its previous group, if any. Threads created afterwards do
+ * not join the group of their creator. The main thread can be added like any
+ * other thread; if the calling thread moves into a throttled group, it is
+ * throttled at the next scheduling point.
+ *
+ * Return: -1 if thread @tid cannot be found or has exited, or if @group
+ * belongs to another scheduler. 0 otherwise.
+ */
+int uthread_group_add(uthread_group_t group, uthread_t tid);
+
+/*
+ * uthread_group_destroy - Deallocate a thread group
+ * @group: Group to deallocate
+ *
+ * Return: -1 if @group is NULL or still contains threads. 0 otherwise.
+ */
+int uthread_group_destroy(uthread_group_t group);
+
+/*
+ * struct uthread_group_stats - Statistics of a thread group
+ */
+struct uthread_group_stats {
+	unsigned long long cpu_ns;	/* time spent running by the threads of
+					   the group, while in the group */
+	unsigned long long throttles;	/* periods in which the budget ran out */
+	int threads;			/* number of threads in the group */
+	int throttled;			/* whether the group is throttled */
+};
+
+/*
+ * uthread_group_stats - Get the statistics of a thread group
+ * @group: Group to query
+ * @stats: Structure receiving the statistics
+ *
+ * Return: -1 if @group or @stats is NULL, 0 otherwise
+ */
+int uthread_group_stats(uthread_group_t group, struct uthread_group_stats *stats);
+
+/*
+ * uthread_arena_alloc - Allocate memory freed when the thread exits
+ * @size: Number of bytes to allocate
+ *
+ * Memory is carved out of chunks attached to the calling thread, which are all
+ * given back at once when it exits (or with uthread_arena_reset()). Blocks
+ * cannot be freed individually, so this suits the many short-lived
+ * allocations of a thread handling a request. Blocks are aligned on 16 bytes.
+ *
+ * Return: Pointer to a block of @size bytes, or NULL if @size is 0 or in case
+ * of memory allocation failure
+ */
+void *uthread_arena_alloc(size_t size);
+
+/*
+ * uthread_arena_reset - Free the arena memory of the calling thread
+ *
+ * Every block allocated by the calling thread with uthread_arena_alloc() is
+ * given back. This lets long-lived threads (e.g. pool workers) reuse their
+ * arena between requests.
+ */
+void uthread_arena_reset(void);
+
+/*
+ * struct uthread_thread_stats - Scheduling statistics of a thread
+ *
+ * Switch counters are always maintained and count the number of times the
+ * thread gave up the processor, either by itself (yield, join, exit) or because
+ * it was preempted by the timer.
+ *
+ * Time counters (in nanoseconds) are only maintained while timing is enabled
+ * with uthread_stats_enable(), except for the CPU time which is measured with
+ * the cycle counter at every switch.
+ */
+struct uthread_thread_stats {
+	unsigned long long switches;	/* times the thread was switched out */
+	unsigned long long voluntary;	/* switches caused by the thread itself */
+	unsigned long long preempted;	/* switches forced by preemption */
+	unsigned long long run_ns;	/* time spent running */
+	unsigned long long wait_ns;	/* time spent ready but not running */
+	unsigned long long join_ns;	/* time spent blocked (join or park) */
+	unsigned long long cpu_ns;	/* time spent running (cycle counter) */
+};
+
+/*
+ * struct uthread_stats - Scheduler-wide statistics
+ *
+ * Counters are the sum of the counters of every thread created so far, and
+ * queue lengths are sampled at the time of the query.
+ */
+struct uthread_stats {
+	unsigned long long switches;	/* total number of context switches */
+	unsigned long long voluntary;	/* voluntary context switches */
+	unsigned long long preempted;	/* context switches forced by preemption */
+	unsigned long long run_ns;	/* time spent running threads */
+	unsigned long long wait_ns;	/* time threads spent ready but waiting */
+	unsigned long long join_ns;	/* time threads spent blocked */
+	unsigned long long deadlines;	/* deadlines admitted */
+	unsigned long long rejected;	/* deadlines refused as already passed */
+	unsigned long long overruns;	/* deadlines missed */
+	unsigned long long cpu_ns;	/* time spent running (cycle counter) */
+	unsigned long long ticks;	/* preemption ticks */
+	unsigned long long ticks_skipped; /* ticks within the time slice */
+	int threads;			/* number of threads created (incl. main) */
+	int stacks;			/* number of thread stacks allocated */
+	int ready;			/* current length of the ready queue */
+	int blocked;			/* current length of the blocked queue */
+	int zombie;			/* current length of the zombie queue */
+};
+
+/*
+ * uthread_stats_enable - Enable or disable time accounting
+ * @enable: Non-zero to timestamp state changes, 0 to stop
+ *
+ * Switch counters are always maintained. Time counters additionally require a
+ * clock read at every state change and are therefore off by default.
+ */
+void uthread_stats_enable(int enable);
+
+/*
+ * uthread_stats - Get scheduler-wide statistics
+ * @stats: Address of the structure receiving the statistics
+ *
+ * Return: -1 if @stats is NULL. 0 otherwise.
+ */
+int uthread_stats(struct uthread_stats *stats);
+
+/*
+ * uthread_thread_stats - Get statistics of a thread
+ * @tid: TID of the thread
+ * @stats: Address of the structure receiving the statistics
+ *
+ * Statistics remain available after the thread has been collected.
+ *
+ * Return: -1 if @stats is NULL or if no thread @tid was ever created. 0
+ * otherwise.
+ */
+int uthread_thread_stats(uthread_t tid, struct uthread_thread_stats *stats);
+
+/*
+ * uthread_stats_dump - Print scheduler and per-thread statistics
+ * @fd: File descriptor to write to
+ */
+void uthread_stats_dump(int fd);
+
+/*
+ * uthread_stats_dump_on - Dump statistics upon reception of a signal
+ * @signum: Signal triggering the dump (e.g. SIGUSR1)
+ * @fd: File descriptor to write to
+ *
+ * The signal handler only records the request; the dump itself is performed
+ * at the next voluntary scheduling point (yield, join, exit or blocking call),
+ * never from a signal handler. Every scheduler dumps its own statistics at
+ * its next scheduling point, whichever kernel thread received the signal.
+ *
+ * Return: -1 if @signum is SIGVTALRM (used for preemption) or if the handler
+ * cannot be installed. 0 otherwise.
+ */
+int uthread_stats_dump_on(int signum, int fd);
+
+/*
+ * struct uthread_latency - Scheduling latency summary
+ *
+ * The scheduling latency is the delay between a thread being made ready (when
+ * created, woken up after a join, or put back in the ready queue by a yield or
+ * a preemption) and the thread actually running. It is always measured and
+ * recorded in a log-linear histogram, with a precision of about 3%.
+ */
+struct uthread_latency {
+	unsigned long long count;	/* number of measured dispatches */
+	unsigned long long min_ns;	/* smallest latency */
+	unsigned long long max_ns;	/* largest latency */
+	unsigned long long mean_ns;	/* average latency */
+	unsigned long long p50_ns;	/* median latency */
+	unsigned long long p99_ns;	/* 99th percentile */
+	unsigned long long p999_ns;	/* 99.9th percentile */
+};
+
+/*
+ * uthread_latency - Get a summary of the scheduling latency
+ * @lat: Address of the structure receiving the summary
+ *
+ * Return: -1 if @lat is NULL. 0 otherwise.
+ */
+int uthread_latency(struct uthread_latency *lat);
+
+/*
+ * uthread_latency_percentile - Get a percentile of the scheduling latency
+ * @percentile: Percentile to compute, between 0 and 100
+ *
+ * Return: Scheduling latency in nanoseconds under which @percentile percent of
+ * the dispatches were done, or 0 if nothing was measured yet
+ */
+unsigned long long uthread_latency_percentile(double percentile);
+
+/*
+ * uthread_latency_reset - Discard the scheduling latency measured so far
+ */
+void uthread_latency_reset(void);
+
+/*
+ * struct uthread_stack_usage - Stack usage of the threads running a function
+ *
+ * The stack usage of a thread is the high-water mark of its stack, i.e. the
+ * number of bytes from the start of the stack to the deepest point reached.
+ */
+struct uthread_stack_usage {
+	uthread_func_t func;		/* function run by the threads (NULL
+					   gathers functions past the first 64) */
+	unsigned long threads;		/* number of threads measured */
+	unsigned long max_bytes;	/* deepest stack usage */
+	unsigned long mean_bytes;	/* average stack usage */
+};
+
+/*
+ * uthread_stack_profile_enable - Enable or disable stack usage profiling
+ * @enable: Non-zero to measure stack usage, 0 to stop
+ *
+ * While enabled, stacks are painted with a known pattern, and the stack of
+ * every exiting thread is measured and accounted to the function the thread
+ * ran. Painting makes allocating and releasing stacks slower, so this is off
+ * by default.
+ *
+ * Stacks allocated before profiling was enabled are only measured from their
+ * second use on.
+ */
+void uthread_stack_profile_enable(int enable);
+
+/*
+ * uthread_stack_profile - Get the stack usage measured so far
+ * @usage: Array receiving the stack usage per function
+ * @n: Number of entries of @usage
+ *
+ * Functions are reported in the order they were first measured.
+ *
+ * Return: -1 if @n is negative or if @usage is NULL while @n is not 0. The
+ * number of entries filled in @usage otherwise.
+ */
+int uthread_stack_profile(struct uthread_stack_usage *usage, int n);
+
+/*
+ * uthread_stack_profile_dump - Print the stack usage measured so far
+ * @fd: File descriptor to write to
+ */
+void uthread_stack_profile_dump(int fd);
+
 #endif /* _THREAD_H */
@@ -0,0 +1,112 @@
+/*
+ * Generator benchmark
+ *
+ * Hands a sequence of integers from a producer to a consumer in two ways, and
+ * reports the throughput in millions of items per second:
+ * - a generator, which switches straight to the consumer at every value
+ * - a producer thread and a consumer thread sharing a queue, which go through
+ *   the scheduler, yielding to each other after every value (queue operations
+ *   run with preemption disabled, as the queue is not thread safe)
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <preempt.h>
+#include <queue.h>
+#include <uthread.h>
+
+/* items are numbered from 1, queues do not take NULL */
+#define ITEMS 1000000L
+
+static queue_t items;
+static int producing;
+
+/*
+ * now - Get the current time in seconds
+ */
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void generate(void *arg)
+{
+    long i;
+
+    for(i = 1; i <= ITEMS; i++)
+        uthread_gen_yield((void*)i);
+}
+
+int produce(void *arg)
+{
+    long i;
+
+    for(i = 1; i <= ITEMS; i++)
+    {
+        preempt_disable();
+        queue_enqueue(items, (void*)i);
+        preempt_enable();
+        uthread_yield();
+    }
+    producing = 0;
+    return 0;
+}
+
+int consume(void *arg)
+{
+    long expected = 1;
+    void *value;
+    int ret;
+
+    while(producing || queue_length(items))
+    {
+        do
+        {
+            preempt_disable();
+            ret = queue_dequeue(items, &value);
+            preempt_enable();
+            if(ret == 0)
+                assert((long)value == expected++);
+        } while(ret == 0);
+        uthread_yield();
+    }
+    assert(expected == ITEMS + 1);
+    return 0;
+}
+
+int main(void)
+{
+    uthread_gen_t gen;
+    uthread_t tids[2];
+    double start, elapsed;
+    long expected = 1;
+    void *value;
+
+    gen = uthread_gen_create(generate, NULL);
+    start = now();
+    while(uthread_gen_next(gen, &value) == 0)
+        assert((long)value == expected++);
+    elapsed = now() - start;
+    assert(expected == ITEMS + 1);
+    uthread_gen_destroy(gen);
+    printf("generator: %.2f Mitems/s\n", ITEMS / elapsed / 1e6);
+
+    items = queue_create();
+    producing = 1;
+    start = now();
+    tids[0] = uthread_create(produce, NULL);
+    tids[1] = uthread_create(consume, NULL);
+    uthread_join(tids[0], NULL);
+    uthread_join(tids[1], NULL);
+    elapsed = now() - start;
+    queue_destroy(items);
+    printf("queue: %.2f Mitems/s\n", ITEMS / elapsed / 1e6);
+
+    return 0;
+}
@@ -0,0 +1,150 @@
+/*
+ * Priority queue throughput benchmark
+ *
+ * Measures the throughput of the priority queue API on three workloads:
+ * - fill/drain: push a large number of items with random keys, then pop them
+ * - hold: pop the smallest item and push it back with a later key, on a queue
+ *   of constant length, like timers or deadlines being rearmed
+ * - decrease: decrease the keys of random items of a large queue
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <pqueue.h>
+
+#define ITEMS 1000000
+#define HOLD_LENGTH 1024
+#define HOLD_OPS 2000000
+#define DECREASE_OPS 1000000
+
+static uint64_t keys[ITEMS];
+static pqueue_handle_t handles[ITEMS];
+
+/*
+ * now - Get the current time in seconds
+ */
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * report - Print the throughput of a workload
+ * @name: name of the workload
+ * @ops: number of priority queue operations performed
+ * @elapsed: duration of the workload in seconds
+ */
+static void report(const char *name, long ops, double elapsed)
+{
+    printf("%-12s %8.2f Mops/s\n", name, ops / elapsed / 1e6);
+}
+
+/*
+ * drain - Pop all the items of a priority queue and destroy it
+ * @pq: the priority queue
+ */
+static void drain(pqueue_t pq)
+{
+    void *ptr;
+
+    while(pqueue_pop(pq, &ptr, NULL) == 0)
+        ;
+    pqueue_destroy(pq);
+}
+
+/*
+ * bench_fill_drain - Push many items with random keys, then pop them all
+ */
+void bench_fill_drain(void)
+{
+    pqueue_t pq = pqueue_create();
+    uint64_t key, prev = 0;
+    double start;
+    void *ptr;
+    int i;
+
+    start = now();
+    for(i = 0; i < ITEMS; i++)
+        pqueue_push(pq, keys[i], &keys[i], NULL);
+    for(i = 0; i < ITEMS; i++)
+    {
+        pqueue_pop(pq, &ptr, &key);
+        assert(key >= prev);
+        prev = key;
+    }
+    report("fill/drain", 2L * ITEMS, now() - start);
+
+    pqueue_destroy(pq);
+}
+
+/*
+ * bench_hold - Rearm the smallest item of a queue of constant length
+ */
+void bench_hold(void)
+{
+    pqueue_t pq = pqueue_create();
+    double start;
+    uint64_t key;
+    void *ptr;
+    int i;
+
+    for(i = 0; i < HOLD_LENGTH; i++)
+        pqueue_push(pq, keys[i], &keys[i], NULL);
+
+    start = now();
+    for(i = 0; i < HOLD_OPS; i++)
+    {
+        pqueue_pop(pq, &ptr, &key);
+        pqueue_push(pq, key + keys[i % ITEMS] % 1000, ptr, NULL);
+    }
+    report("hold", 2L * HOLD_OPS, now() - start);
+
+    drain(pq);
+}
+
+/*
+ * bench_decrease - Decrease the keys of random items of a large queue
+ */
+void bench_decrease(void)
+{
+    pqueue_t pq = pqueue_create();
+    double start;
+    int i;
+
+    for(i = 0; i < ITEMS; i++)
+        pqueue_push(pq, keys[i], &keys[i], &handles[i]);
+
+    start = now();
+    for(i = 0; i < DECREASE_OPS; i++)
+    {
+        int j = keys[i] % ITEMS;
+
+        /* keys are never negative, so at worst they stay at 0 */
+        keys[j] /= 2;
+        pqueue_decrease_key(pq, handles[j], keys[j]);
+    }
+    report("decrease", DECREASE_OPS, now() - start);
+
+    drain(pq);
+}
+
+int main(void)
+{
+    int i;
+
+    srand(42);
+    for(i = 0; i < ITEMS; i++)
+        keys[i] = ((uint64_t)rand() << 16) ^ rand();
+
+    bench_fill_drain();
+    bench_hold();
+    bench_decrease();
+    return 0;
+}
@@ -0,0 +1,143 @@
+/*
+ * Queue throughput benchmark
+ *
+ * Measures the throughput of the queue API on three workloads:
+ * - fill/drain: enqueue a large number of items, then dequeue them all
+ * - steady: dequeue and re-enqueue items of a queue of constant length, like
+ *   a round-robin ready queue
+ * - iterate: walk a large queue with queue_iterate()
+ *
+ * The program is linked once against each queue backend (bench_queue.x for
+ * the linked list, bench_queue_ring.x for the ring buffer) so that their
+ * numbers can be compared.
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <queue.h>
+
+#define ITEMS 1000000
+#define STEADY_LENGTH 64
+#define STEADY_OPS 4000000
+#define ITERATIONS 20
+
+static int items[ITEMS];
+
+/*
+ * now - Get the current time in seconds
+ */
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * count_item - Callback function that counts the items of a queue
+ * @data: data item
+ * @arg: address of the counter
+ */
+static int count_item(void *data, void *arg)
+{
+    (*(long*)arg)++;
+    return 0;
+}
+
+/*
+ * report - Print the throughput of a workload
+ * @name: name of the workload
+ * @ops: number of queue operations performed
+ * @elapsed: duration of the workload in seconds
+ */
+static void report(const char *name, long ops, double elapsed)
+{
+    printf("%-12s %8.2f Mops/s\n", name, ops / elapsed / 1e6);
+}
+
+/*
+ * bench_fill_drain - Enqueue many items, then dequeue them all
+ */
+void bench_fill_drain(void)
+{
+    queue_t q = queue_create();
+    double start;
+    void *ptr;
+    int i;
+
+    start = now();
+    for(i = 0; i < ITEMS; i++)
+        queue_enqueue(q, &items[i]);
+    for(i = 0; i < ITEMS; i++)
+    {
+        queue_dequeue(q, &ptr);
+        assert(ptr == &items[i]);
+    }
+    report("fill/drain", 2L * ITEMS, now() - start);
+
+    queue_destroy(q);
+}
+
+/*
+ * bench_steady - Rotate the items of a queue of constant length
+ */
+void bench_steady(void)
+{
+    queue_t q = queue_create();
+    double start;
+    void *ptr;
+    int i;
+
+    for(i = 0; i < STEADY_LENGTH; i++)
+        queue_enqueue(q, &items[i]);
+
+    start = now();
+    for(i = 0; i < STEADY_OPS; i++)
+    {
+        queue_dequeue(q, &ptr);
+        queue_enqueue(q, ptr);
+    }
+    report("steady", 2L * STEADY_OPS, now() - start);
+
+    while(queue_dequeue(q, &ptr) == 0)
+        ;
+    queue_destroy(q);
+}
+
+/*
+ * bench_iterate - Walk a large queue
+ */
+void bench_iterate(void)
+{
+    queue_t q = queue_create();
+    long count = 0;
+    double start;
+    void *ptr;
+    int i;
+
+    for(i = 0; i < ITEMS; i++)
+        queue_enqueue(q, &items[i]);
+
+    start = now();
+    for(i = 0; i < ITERATIONS; i++)
+        queue_iterate(q, count_item, &count, NULL);
+    report("iterate", count, now() - start);
+    assert(count == (long)ITEMS * ITERATIONS);
+
+    while(queue_dequeue(q, &ptr) == 0)
+        ;
+    queue_destroy(q);
+}
+
+int main(int argc, char **argv)
+{
+    printf("%s\n", argv[0]);
+    bench_fill_drain();
+    bench_steady();
+    bench_iterate();
+    return 0;
+}
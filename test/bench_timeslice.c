@@ -0,0 +1,111 @@
+/*
+ * Time slicing benchmark
+ *
+ * Runs groups of CPU-bound threads, which spin incrementing a counter, with a
+ * fixed 10 ms quantum and with the default adaptive time slices. For each
+ * configuration, reports:
+ * - the throughput, in millions of increments per second
+ * - the fairness, as Jain's index over the CPU time of the threads (1.0 when
+ *   all threads got the same share, 1/n when one thread got everything)
+ * - the number of preemptions and of ticks skipped because the running thread
+ *   had not used its slice
+ * - the 99th percentile of the scheduling latency
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <uthread.h>
+
+#define DURATION 0.2
+#define MAX_THREADS 32
+
+static volatile int stop;
+static volatile unsigned long counters[MAX_THREADS];
+
+/*
+ * now - Get the current time in seconds
+ */
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int spinner(void* arg)
+{
+    volatile unsigned long *counter = arg;
+
+    while(!stop)
+        (*counter)++;
+    return 0;
+}
+
+/*
+ * run - Run a group of spinning threads and report
+ * @name: name of the configuration
+ * @n: number of threads
+ */
+static void run(const char *name, int n)
+{
+    struct uthread_stats before, after;
+    struct uthread_thread_stats t;
+    uthread_t tids[MAX_THREADS];
+    double start, elapsed, sum = 0, sum_squares = 0;
+    unsigned long total = 0;
+    int i;
+
+    stop = 0;
+    uthread_latency_reset();
+    uthread_stats(&before);
+    for(i = 0; i < n; i++)
+    {
+        counters[i] = 0;
+        tids[i] = uthread_create(spinner, (void*)&counters[i]);
+    }
+
+    /* main takes part, it yields right away so threads start together */
+    start = now();
+    uthread_yield();
+    while(now() - start < DURATION)
+        ;
+    stop = 1;
+    elapsed = now() - start;
+
+    for(i = 0; i < n; i++)
+    {
+        uthread_thread_stats(tids[i], &t);
+        uthread_join(tids[i], NULL);
+        total += counters[i];
+        sum += t.cpu_ns;
+        sum_squares += (double)t.cpu_ns * t.cpu_ns;
+    }
+    uthread_stats(&after);
+
+    printf("%-9s %3d threads %8.2f Mops/s  fairness %.3f  "
+        "%5llu preemptions %5llu ticks skipped  p99 %8.3f ms\n",
+        name, n, total / elapsed / 1e6, sum * sum / (n * sum_squares),
+        after.preempted - before.preempted,
+        after.ticks_skipped - before.ticks_skipped,
+        uthread_latency_percentile(99.0) / 1e6);
+}
+
+int main(void)
+{
+    static const int counts[] = { 2, 8, 32 };
+    int i;
+
+    for(i = 0; i < 3; i++)
+    {
+        assert(uthread_set_timeslice(10000000, 10000000, 0) == 0);
+        run("fixed", counts[i]);
+        assert(uthread_set_timeslice(1000000, 10000000, 20000000) == 0);
+        run("adaptive", counts[i]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Arena allocation test
+ *
+ * Tests the uthread_arena functions. Threads allocate many small blocks and a
+ * few large ones from their arena, which is freed when they exit. Blocks are
+ * aligned and do not overlap, and threads allocating concurrently do not
+ * corrupt each other's blocks. Sizes too large to be rounded up fail. The
+ * main thread can reset its own arena.
+ *
+ * Output:
+ * 4 threads, 10000 blocks each
+ * main arena reset
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <uthread.h>
+
+#define THREADS 4
+#define BLOCKS 10000
+#define LARGE 100000
+
+int thread(void* arg)
+{
+    unsigned char **blocks;
+    unsigned char *large;
+    int i, id = (long)arg;
+
+    /* too large for the thread stack */
+    blocks = uthread_arena_alloc(BLOCKS * sizeof(*blocks));
+    assert(blocks);
+
+    for(i = 0; i < BLOCKS; i++)
+    {
+        size_t size = 1 + i % 100;
+
+        blocks[i] = uthread_arena_alloc(size);
+        assert(blocks[i]);
+        assert(((uintptr_t)blocks[i] & 15) == 0);
+        memset(blocks[i], id + i, size);
+
+        /* large blocks do not disturb the chunk being bumped */
+        if(i % 2500 == 0)
+        {
+            large = uthread_arena_alloc(LARGE);
+            assert(large);
+            memset(large, 0xff, LARGE);
+        }
+
+        if(i % 100 == 0)
+            uthread_yield();
+    }
+
+    /* every block kept its content */
+    for(i = 0; i < BLOCKS; i++)
+    {
+        size_t j, size = 1 + i % 100;
+
+        for(j = 0; j < size; j++)
+            assert(blocks[i][j] == (unsigned char)(id + i));
+    }
+
+    return 0;
+}
+
+int main(void)
+{
+    char *a, *b;
+    int i;
+
+    assert(uthread_arena_alloc(0) == NULL);
+
+    /* sizes which would wrap around once rounded up or with the chunk header */
+    assert(uthread_arena_alloc(SIZE_MAX) == NULL);
+    assert(uthread_arena_alloc(SIZE_MAX - 20) == NULL);
+    assert(uthread_arena_alloc(SIZE_MAX - 40) == NULL);
+
+    for(i = 0; i < THREADS; i++)
+        uthread_create(thread, (void*)(long)i);
+    for(i = 1; i <= THREADS; i++)
+        assert(uthread_join(i, NULL) == 0);
+    printf("%d threads, %d blocks each\n", THREADS, BLOCKS);
+
+    /* after a reset, the memory of main is handed out again */
+    a = uthread_arena_alloc(64);
+    uthread_arena_reset();
+    b = uthread_arena_alloc(64);
+    assert(a && b);
+    printf("main arena reset\n");
+
+    return 0;
+}
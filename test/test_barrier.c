@@ -0,0 +1,118 @@
+/*
+ * Barrier and latch test
+ *
+ * Tests the uthread_barrier and uthread_latch primitives. A group of threads
+ * runs a number of steps, synchronizing on a barrier after each of them: no
+ * thread may start a step before all the others finished the previous one, and
+ * exactly one thread per step is told it arrived last. Then threads waiting on
+ * a latch are only released by the last count down. Finally, a barrier with
+ * many waiters releases all of them at once when the last thread arrives.
+ *
+ * Output:
+ * 8 threads, 100 steps, 100 serial threads
+ * latch released 4 waiters
+ * wide barrier released 200 waiters
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <barrier.h>
+#include <uthread.h>
+
+#define THREADS 8
+#define STEPS 100
+#define WAITERS 4
+#define WIDE 200
+
+static uthread_barrier_t barrier;
+static int step[THREADS];
+static int serial = 0;
+
+static uthread_latch_t latch;
+static int released = 0;
+
+int stepper(void* arg)
+{
+    int id = (long)arg;
+    int i, j;
+
+    for(i = 0; i < STEPS; i++)
+    {
+        /* nobody can be ahead or behind */
+        for(j = 0; j < THREADS; j++)
+            assert(step[j] == i || step[j] == i + 1);
+        step[id] = i + 1;
+
+        if(uthread_barrier_wait(&barrier) == UTHREAD_BARRIER_SERIAL_THREAD)
+            serial++;
+    }
+
+    return 0;
+}
+
+int waiter(void* arg)
+{
+    assert(uthread_latch_wait(&latch) == 0);
+    released++;
+    return 0;
+}
+
+int wide_waiter(void* arg)
+{
+    return uthread_barrier_wait(&barrier) == UTHREAD_BARRIER_SERIAL_THREAD;
+}
+
+int main(void)
+{
+    struct uthread_stats s;
+    int i, retval;
+    uthread_t first;
+
+    assert(uthread_barrier_init(&barrier, 0) == -1);
+    assert(uthread_barrier_init(&barrier, THREADS) == 0);
+    for(i = 0; i < THREADS; i++)
+        uthread_create(stepper, (void*)(long)i);
+    for(i = 1; i <= THREADS; i++)
+        assert(uthread_join(i, NULL) == 0);
+    printf("%d threads, %d steps, %d serial threads\n", THREADS, STEPS, serial);
+    assert(serial == STEPS);
+
+    assert(uthread_latch_init(&latch, WAITERS - 1) == 0);
+    for(i = 0; i < WAITERS; i++)
+        uthread_create(waiter, NULL);
+    for(i = 0; i < WAITERS - 1; i++)
+    {
+        uthread_yield();
+        assert(released == 0);
+        assert(uthread_latch_count_down(&latch) == 0);
+    }
+    for(i = 1; i <= WAITERS; i++)
+        assert(uthread_join(THREADS + i, NULL) == 0);
+    printf("latch released %d waiters\n", released);
+    assert(released == WAITERS);
+
+    /* an open latch does not block */
+    assert(uthread_latch_count_down(&latch) == 0);
+    assert(uthread_latch_wait(&latch) == 0);
+
+    /* main arrives last and leaves no waiter parked */
+    assert(uthread_barrier_init(&barrier, WIDE + 1) == 0);
+    first = uthread_create(wide_waiter, NULL);
+    for(i = 1; i < WIDE; i++)
+        uthread_create(wide_waiter, NULL);
+    while(barrier.arrived < WIDE)
+        uthread_yield();
+    assert(uthread_barrier_wait(&barrier) == UTHREAD_BARRIER_SERIAL_THREAD);
+    uthread_stats(&s);
+    assert(s.blocked == 0);
+    for(i = 0; i < WIDE; i++)
+    {
+        assert(uthread_join(first + i, &retval) == 0);
+        assert(retval == 0);
+    }
+    printf("wide barrier released %d waiters\n", WIDE);
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * Batch thread creation test
+ *
+ * Tests the uthread_create_n function. Main creates a batch of threads, each
+ * receiving its own argument, and joins them. Threads must get consecutive
+ * TIDs and run in creation order.
+ *
+ * Output:
+ * thread1, arg 10
+ * thread2, arg 20
+ * thread3, arg 30
+ * thread4, arg 40
+ * thread5, arg 0
+ * thread6, arg 0
+ * thread7, arg 0
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <uthread.h>
+
+#define THREADS 4
+#define BIG_BATCH 100
+
+int thread(void* arg)
+{
+    int value = arg ? *(int*)arg : 0;
+
+    printf("thread%d, arg %d\n", uthread_self(), value);
+    return value;
+}
+
+int quiet(void* arg)
+{
+    return uthread_self();
+}
+
+int main(void)
+{
+    uthread_t big[BIG_BATCH];
+    int values[THREADS] = {10, 20, 30, 40};
+    void *args[THREADS];
+    uthread_t tids[THREADS];
+    int i, retval;
+
+    /* invalid batches */
+    assert(uthread_create_n(NULL, NULL, 1, NULL) == -1);
+    assert(uthread_create_n(thread, NULL, 0, NULL) == -1);
+
+    /* batch with one argument per thread */
+    for(i = 0; i < THREADS; i++)
+        args[i] = &values[i];
+    assert(uthread_create_n(thread, args, THREADS, tids) == THREADS);
+    for(i = 0; i < THREADS; i++)
+        assert(tids[i] == i + 1);
+
+    for(i = 0; i < THREADS; i++)
+    {
+        assert(uthread_join(tids[i], &retval) == 0);
+        assert(retval == values[i]);
+    }
+
+    /* batch without arguments nor TIDs, mixed with regular creation */
+    assert(uthread_create_n(thread, NULL, 2, NULL) == 2);
+    assert(uthread_create(thread, NULL) == THREADS + 3);
+    assert(uthread_join(THREADS + 1, NULL) == 0);
+    assert(uthread_join(THREADS + 2, NULL) == 0);
+    assert(uthread_join(THREADS + 3, NULL) == 0);
+
+    /* batch larger than what is queued at once */
+    assert(uthread_create_n(quiet, NULL, BIG_BATCH, big) == BIG_BATCH);
+    for(i = 0; i < BIG_BATCH; i++)
+    {
+        assert(uthread_join(big[i], &retval) == 0);
+        assert(retval == big[i]);
+    }
+
+    return 0;
+}
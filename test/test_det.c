@@ -0,0 +1,179 @@
+/*
+ * Deterministic scheduling test
+ *
+ * Tests the uthread_det functions. Workers interleave their steps, marked with
+ * uthread_det_point(), according to the seed: each run happens on a kernel
+ * thread of its own, with a new scheduler, and two runs with the same seed go
+ * through the same schedule while another seed gives another one. Replaying
+ * the schedule recorded with a seed reproduces it under another seed. The
+ * preemption timer does not interrupt a thread which spins without scheduling
+ * points.
+ *
+ * Output:
+ * same seed, same schedule: 100 steps
+ * other seed, other schedule
+ * replayed schedule matches
+ * no preemption while spinning
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <uthread.h>
+
+#define WORKERS 4
+#define STEPS 25
+#define TRACE_MAX 1024
+
+/* a run of the workers under a given schedule */
+struct run
+{
+    unsigned long long seed;
+    const uthread_t *replay;
+    int replay_length;
+    int order[WORKERS * STEPS];
+    int length;
+    uthread_t trace[TRACE_MAX];
+    int trace_length;
+};
+
+struct worker
+{
+    struct run *run;
+    int index;
+};
+
+static volatile int spinning = 0;
+static volatile int ran_while_spinning = 0;
+static uthread_t watcher_tid;
+
+int worker(void* arg)
+{
+    struct worker *w = arg;
+    int i;
+
+    for(i = 0; i < STEPS; i++)
+    {
+        w->run->order[w->run->length++] = w->index;
+        uthread_det_point();
+    }
+    return 0;
+}
+
+void *run_thread(void *arg)
+{
+    struct worker workers[WORKERS];
+    struct run *r = arg;
+    uthread_t tids[WORKERS];
+    int i;
+
+    uthread_det_enable(r->seed, 3);
+    if(r->replay)
+        assert(uthread_det_replay(r->replay, r->replay_length) == 0);
+
+    for(i = 0; i < WORKERS; i++)
+    {
+        workers[i].run = r;
+        workers[i].index = i;
+        tids[i] = uthread_create(worker, &workers[i]);
+    }
+    for(i = 0; i < WORKERS; i++)
+        assert(uthread_join(tids[i], NULL) == 0);
+
+    r->trace_length = uthread_det_trace(r->trace, TRACE_MAX);
+    assert(r->trace_length > 0 && r->trace_length <= TRACE_MAX);
+    uthread_det_disable();
+
+    return NULL;
+}
+
+/*
+ * run - Run the workers on a new kernel thread, and so a new scheduler
+ * @r: the run
+ * @seed: seed of the schedule
+ * @replay: (Optional) run whose schedule is replayed
+ */
+static void run(struct run *r, unsigned long long seed, struct run *replay)
+{
+    pthread_t thread;
+
+    memset(r, 0, sizeof(*r));
+    r->seed = seed;
+    if(replay)
+    {
+        r->replay = replay->trace;
+        r->replay_length = replay->trace_length;
+    }
+    assert(pthread_create(&thread, NULL, run_thread, r) == 0);
+    pthread_join(thread, NULL);
+    assert(r->length == WORKERS * STEPS);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int watcher(void* arg)
+{
+    if(spinning)
+        ran_while_spinning = 1;
+    return 0;
+}
+
+int spinner(void* arg)
+{
+    double start;
+
+    /* the watcher is ready during the whole spin */
+    watcher_tid = uthread_create(watcher, NULL);
+    start = now();
+    spinning = 1;
+    while(now() - start < 0.05)
+        ;
+    spinning = 0;
+    return 0;
+}
+
+int main(void)
+{
+    static struct run first, second, other, replayed;
+    uthread_t tid;
+
+    assert(uthread_det_trace(NULL, -1) == -1);
+    assert(uthread_det_replay(NULL, 0) == -1);
+
+    run(&first, 42, NULL);
+    run(&second, 42, NULL);
+    assert(!memcmp(first.order, second.order, sizeof(first.order)));
+    assert(first.trace_length == second.trace_length);
+    assert(!memcmp(first.trace, second.trace, first.trace_length * sizeof(uthread_t)));
+    printf("same seed, same schedule: %d steps\n", first.length);
+
+    run(&other, 43, NULL);
+    assert(memcmp(first.order, other.order, sizeof(first.order)));
+    printf("other seed, other schedule\n");
+
+    run(&replayed, 7, &first);
+    assert(!memcmp(first.order, replayed.order, sizeof(first.order)));
+    assert(replayed.trace_length == first.trace_length);
+    printf("replayed schedule matches\n");
+
+    /* ticks keep firing but do not switch threads */
+    uthread_det_enable(1, 1);
+    tid = uthread_create(spinner, NULL);
+    assert(uthread_join(tid, NULL) == 0);
+    assert(uthread_join(watcher_tid, NULL) == 0);
+    assert(!ran_while_spinning);
+    uthread_det_disable();
+    printf("no preemption while spinning\n");
+
+    return 0;
+}
@@ -0,0 +1,125 @@
+/*
+ * Earliest deadline first test
+ *
+ * Tests the uthread_set_deadline function. Threads given a deadline run before
+ * best-effort threads, earliest deadline first, while best-effort threads keep
+ * their FIFO order. Deadlines already passed are rejected, and a thread still
+ * running past its deadline is counted as an overrun. A thread with a deadline
+ * which yields keeps running while only best-effort threads are ready.
+ *
+ * Output:
+ * order: 6 5 4 1 2 3
+ * 3 admitted, 1 rejected, 0 overruns
+ * 4 admitted, 1 rejected, 1 overruns
+ * yields: 10 10 10 8 9
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <uthread.h>
+
+#define MS 1000000ULL
+
+static int order[6];
+static int ran = 0;
+
+static unsigned long long now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int thread(void* arg)
+{
+    order[ran++] = uthread_self();
+    return 0;
+}
+
+int yielder(void* arg)
+{
+    int i;
+
+    for(i = 0; i < 3; i++)
+    {
+        order[ran++] = uthread_self();
+        uthread_yield();
+    }
+    return 0;
+}
+
+int late(void* arg)
+{
+    unsigned long long start = now_ns();
+
+    /* run past the deadline */
+    while(now_ns() - start < 3 * MS)
+        ;
+    return 0;
+}
+
+int main(void)
+{
+    struct uthread_stats s;
+    unsigned long long now;
+    int i;
+
+    for(i = 0; i < 6; i++)
+        uthread_create(thread, NULL);
+
+    /* threads 4 to 6 get deadlines, the latest created being the most urgent */
+    now = now_ns();
+    for(i = 4; i <= 6; i++)
+        assert(uthread_set_deadline(i, now + (10 - i) * 1000 * MS) == 0);
+    assert(uthread_set_deadline(1, now - MS) == -1);
+    assert(uthread_set_deadline(100, now + MS) == -1);
+
+    for(i = 1; i <= 6; i++)
+        assert(uthread_join(i, NULL) == 0);
+    printf("order:");
+    for(i = 0; i < ran; i++)
+        printf(" %d", order[i]);
+    printf("\n");
+    assert(order[0] == 6 && order[1] == 5 && order[2] == 4);
+    assert(order[3] == 1 && order[4] == 2 && order[5] == 3);
+
+    uthread_stats(&s);
+    printf("%llu admitted, %llu rejected, %llu overruns\n",
+        s.deadlines, s.rejected, s.overruns);
+    assert(s.deadlines == 3 && s.rejected == 1 && s.overruns == 0);
+
+    /* exited threads cannot get a deadline */
+    assert(uthread_set_deadline(6, now_ns() + MS) == -1);
+
+    /* the deadline passes before the thread is done */
+    i = uthread_create(late, NULL);
+    assert(uthread_set_deadline(i, now_ns() + MS) == 0);
+    assert(uthread_join(i, NULL) == 0);
+    uthread_stats(&s);
+    printf("%llu admitted, %llu rejected, %llu overruns\n",
+        s.deadlines, s.rejected, s.overruns);
+    assert(s.deadlines == 4 && s.overruns == 1);
+
+    /* best-effort threads wait for the deadline thread, even when it yields */
+    uthread_t be1 = uthread_create(thread, NULL);
+    uthread_t be2 = uthread_create(thread, NULL);
+    i = uthread_create(yielder, NULL);
+    assert(uthread_set_deadline(i, now_ns() + 1000 * MS) == 0);
+    ran = 0;
+    assert(uthread_join(i, NULL) == 0);
+    assert(uthread_join(be1, NULL) == 0);
+    assert(uthread_join(be2, NULL) == 0);
+    printf("yields:");
+    for(int j = 0; j < ran; j++)
+        printf(" %d", order[j]);
+    printf("\n");
+    assert(ran == 5);
+    assert(order[0] == i && order[1] == i && order[2] == i);
+    assert(order[3] == be1 && order[4] == be2);
+
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * Future test
+ *
+ * Tests the uthread_future_complete and uthread_await functions. Many threads
+ * wait for the same future and are all woken up by its completion, in the
+ * order they started waiting. Waiting for a completed future returns right
+ * away, and a future can only be completed once. A pipeline of threads passes
+ * a value along a chain of futures. Waiting with no other thread left to
+ * complete the future fails.
+ *
+ * Output:
+ * 100 waiters got "hello"
+ * pipeline: 10
+ * deadlock detected
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <uthread.h>
+
+#define WAITERS 100
+#define STAGES 10
+
+static uthread_future_t greeting;
+static uthread_future_t stages[STAGES + 1];
+static int order[WAITERS];
+static int woken = 0;
+
+int waiter(void* arg)
+{
+    void *value;
+    size_t size;
+
+    assert(uthread_await(&greeting, &value, &size) == 0);
+    assert(size == 6 && !strcmp(value, "hello"));
+    order[woken++] = uthread_self();
+    return 0;
+}
+
+int stage(void* arg)
+{
+    long i = (long)arg;
+    void *value;
+
+    /* each stage adds one to the value of the previous one */
+    assert(uthread_await(&stages[i], &value, NULL) == 0);
+    assert(uthread_future_complete(&stages[i + 1], (void*)((long)value + 1), 0) == 0);
+    return 0;
+}
+
+int main(void)
+{
+    uthread_future_t never;
+    void *value;
+    size_t size;
+    int i;
+
+    assert(uthread_future_init(NULL) == -1);
+    assert(uthread_future_init(&greeting) == 0);
+
+    /* all the waiters block before the completion */
+    assert(uthread_create_n(waiter, NULL, WAITERS, NULL) == WAITERS);
+    uthread_yield();
+    assert(woken == 0);
+
+    assert(uthread_future_complete(&greeting, "hello", 6) == 0);
+    assert(uthread_future_complete(&greeting, "again", 6) == -1);
+    for(i = 1; i <= WAITERS; i++)
+        assert(uthread_join(i, NULL) == 0);
+    for(i = 0; i < WAITERS; i++)
+        assert(order[i] == i + 1);
+
+    /* already completed */
+    assert(uthread_await(&greeting, &value, &size) == 0);
+    printf("%d waiters got \"%s\"\n", woken, (char*)value);
+
+    /* stages are created last first, so each one waits for the previous */
+    for(i = 0; i <= STAGES; i++)
+        uthread_future_init(&stages[i]);
+    for(i = STAGES - 1; i >= 0; i--)
+        assert(uthread_create(stage, (void*)(long)i) > 0);
+    uthread_yield();
+    assert(uthread_future_complete(&stages[0], (void*)0L, 0) == 0);
+    assert(uthread_await(&stages[STAGES], &value, NULL) == 0);
+    printf("pipeline: %ld\n", (long)value);
+
+    /* nothing could complete the future */
+    uthread_future_init(&never);
+    assert(uthread_await(&never, NULL, NULL) == -1);
+    printf("deadlock detected\n");
+
+    return 0;
+}
@@ -0,0 +1,119 @@
+/*
+ * Generator test
+ *
+ * Tests the uthread_gen_create, uthread_gen_next and uthread_gen_yield
+ * functions. A generator produces the Fibonacci numbers and is done once its
+ * function returns. A generator can be destroyed before it is done, and can
+ * advance another generator. Generators work before the library is
+ * initialized, and several threads can each advance their own generator while
+ * yielding to each other.
+ *
+ * Output:
+ * fib: 0 1 1 2 3 5 8 13 21 34
+ * destroyed early
+ * nested: 1 2 3 4 5 6
+ * interleaved: 2 threads, 100 values each
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <uthread.h>
+
+#define VALUES 100
+
+void fib(void *arg)
+{
+    long i, n = (long)arg, a = 0, b = 1, t;
+
+    for(i = 0; i < n; i++)
+    {
+        assert(uthread_gen_yield((void*)a) == 0);
+        t = a + b;
+        a = b;
+        b = t;
+    }
+}
+
+void count(void *arg)
+{
+    long i;
+
+    for(i = 1; i <= (long)arg; i++)
+        uthread_gen_yield((void*)i);
+}
+
+/* yields every value of an inner generator, doubling them back */
+void halves(void *arg)
+{
+    uthread_gen_t inner = uthread_gen_create(count, arg);
+    void *value;
+
+    while(uthread_gen_next(inner, &value) == 0)
+        uthread_gen_yield(value);
+    uthread_gen_destroy(inner);
+}
+
+int consumer(void *arg)
+{
+    uthread_gen_t gen = uthread_gen_create(count, (void*)(long)VALUES);
+    void *value;
+    long expected = 1;
+
+    /* the other consumer runs between every value */
+    while(uthread_gen_next(gen, &value) == 0)
+    {
+        assert((long)value == expected++);
+        uthread_yield();
+    }
+    assert(uthread_gen_destroy(gen) == 0);
+
+    return expected - 1;
+}
+
+int main(void)
+{
+    uthread_gen_t gen;
+    uthread_t tids[2];
+    void *value;
+    int i, retval;
+
+    assert(uthread_gen_create(NULL, NULL) == NULL);
+    assert(uthread_gen_next(NULL, NULL) == -1);
+    assert(uthread_gen_yield(NULL) == -1);
+
+    /* before the library is initialized */
+    gen = uthread_gen_create(fib, (void*)10L);
+    assert(gen);
+    printf("fib:");
+    while(uthread_gen_next(gen, &value) == 0)
+        printf(" %ld", (long)value);
+    printf("\n");
+    assert(uthread_gen_next(gen, &value) == -1);
+    assert(uthread_gen_destroy(gen) == 0);
+
+    gen = uthread_gen_create(count, (void*)1000L);
+    assert(uthread_gen_next(gen, &value) == 0 && (long)value == 1);
+    assert(uthread_gen_destroy(gen) == 0);
+    printf("destroyed early\n");
+
+    gen = uthread_gen_create(halves, (void*)6L);
+    printf("nested:");
+    while(uthread_gen_next(gen, &value) == 0)
+        printf(" %ld", (long)value);
+    printf("\n");
+    assert(uthread_gen_yield(NULL) == -1);
+    assert(uthread_gen_destroy(gen) == 0);
+
+    for(i = 0; i < 2; i++)
+        tids[i] = uthread_create(consumer, NULL);
+    for(i = 0; i < 2; i++)
+    {
+        assert(uthread_join(tids[i], &retval) == 0);
+        assert(retval == VALUES);
+    }
+    printf("interleaved: 2 threads, %d values each\n", VALUES);
+
+    return 0;
+}
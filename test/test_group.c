@@ -0,0 +1,134 @@
+/*
+ * Thread group test
+ *
+ * Tests the uthread_group functions. A CPU-bound batch thread in a group with
+ * a budget of 20% competes with an interactive thread outside of any group,
+ * which gets most of the processor. A group thread running alone is throttled
+ * at every period and the kernel thread sleeps until the budget comes back.
+ * Joining other threads while a group thread is throttled does not lose it. A
+ * group cannot be destroyed while it contains threads.
+ *
+ * Output:
+ * batch share under 35%
+ * alone: 20 ms of work took at least 50 ms
+ * throttled thread joined last
+ * empty group destroyed
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <uthread.h>
+
+#define MS 1000000ULL
+#define DURATION 0.2
+
+static volatile unsigned long counters[2];
+
+/*
+ * now - Get the current time in seconds
+ */
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int spinner(void* arg)
+{
+    volatile unsigned long *counter = arg;
+    double start = now();
+
+    while(now() - start < DURATION)
+        (*counter)++;
+    return 0;
+}
+
+/* spins until it used the given amount of processor time */
+int burner(void* arg)
+{
+    struct uthread_thread_stats stats;
+    volatile unsigned long i;
+
+    /* mostly user time, which is what the preemption timer counts */
+    do
+    {
+        for(i = 0; i < 10000; i++)
+            ;
+        uthread_thread_stats(uthread_self(), &stats);
+    } while(stats.cpu_ns < (unsigned long long)(long)arg);
+    return 0;
+}
+
+int main(void)
+{
+    struct uthread_thread_stats batch, interactive;
+    struct uthread_group_stats stats;
+    uthread_group_t group;
+    uthread_t tids[2];
+    double start, share;
+
+    assert(uthread_group_create(0, 10 * MS) == NULL);
+    assert(uthread_group_create(2 * MS, 0) == NULL);
+    assert(uthread_group_stats(NULL, &stats) == -1);
+
+    /* the batch thread gets 2 ms every 10 ms */
+    group = uthread_group_create(2 * MS, 10 * MS);
+    assert(group);
+    uthread_stats_enable(1);
+    tids[0] = uthread_create(spinner, (void*)&counters[0]);
+    tids[1] = uthread_create(spinner, (void*)&counters[1]);
+    assert(uthread_group_add(group, tids[0]) == 0);
+    assert(uthread_group_add(group, 1000) == -1);
+    assert(uthread_group_stats(group, &stats) == 0 && stats.threads == 1);
+    assert(uthread_group_destroy(group) == -1);
+
+    assert(uthread_join(tids[0], NULL) == 0);
+    assert(uthread_join(tids[1], NULL) == 0);
+    uthread_thread_stats(tids[0], &batch);
+    uthread_thread_stats(tids[1], &interactive);
+    share = (double)batch.cpu_ns / (batch.cpu_ns + interactive.cpu_ns);
+    assert(share < 0.35);
+    assert(uthread_group_stats(group, &stats) == 0);
+    assert(stats.throttles > 0 && stats.threads == 0);
+    printf("batch share under 35%%\n");
+
+    /* 20 ms of work with 2 ms every 20 ms, even if the preemption timer
+     * only fires every 10 ms (run time past the budget is paid back later)
+     */
+    assert(uthread_group_destroy(group) == 0);
+    group = uthread_group_create(2 * MS, 20 * MS);
+    tids[0] = uthread_create(burner, (void*)(long)(20 * MS));
+    assert(uthread_group_add(group, tids[0]) == 0);
+    start = now();
+    assert(uthread_join(tids[0], NULL) == 0);
+    assert(now() - start >= 0.05);
+    assert(uthread_group_stats(group, &stats) == 0 && stats.throttles > 0);
+    printf("alone: 20 ms of work took at least 50 ms\n");
+
+    /* the group thread is throttled when the other one is collected, and
+     * nothing else is left in the scheduler queues
+     */
+    tids[0] = uthread_create(burner, (void*)(long)(10 * MS));
+    assert(uthread_group_add(group, tids[0]) == 0);
+    tids[1] = uthread_create(burner, (void*)0L);
+    assert(uthread_join(tids[1], NULL) == 0);
+    assert(uthread_join(tids[0], NULL) == 0);
+    printf("throttled thread joined last\n");
+
+    /* leaving the group */
+    tids[0] = uthread_create(burner, (void*)0L);
+    assert(uthread_group_add(group, tids[0]) == 0);
+    assert(uthread_group_destroy(group) == -1);
+    assert(uthread_group_add(NULL, tids[0]) == 0);
+    assert(uthread_group_stats(group, &stats) == 0 && stats.threads == 0);
+    assert(uthread_group_destroy(group) == 0);
+    assert(uthread_join(tids[0], NULL) == 0);
+    printf("empty group destroyed\n");
+
+    return 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * Scheduling latency test
+ *
+ * Tests the scheduling latency histogram. Main creates a few threads which
+ * yield to each other a number of times, so that every yield results in a
+ * measured dispatch. The test checks the number of measurements and that the
+ * reported percentiles are ordered.
+ *
+ * Output:
+ * latency OK
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <uthread.h>
+
+#define THREADS 4
+#define YIELDS 100
+
+int thread(void* arg)
+{
+    int i;
+
+    for(i = 0; i < YIELDS; i++)
+        uthread_yield();
+    return 0;
+}
+
+int main(void)
+{
+    struct uthread_latency lat;
+    uthread_t tids[THREADS];
+    int i;
+
+    /* nothing measured yet */
+    assert(uthread_latency(&lat) == 0);
+    assert(lat.count == 0 && lat.p99_ns == 0);
+    assert(uthread_latency(NULL) == -1);
+
+    for(i = 0; i < THREADS; i++)
+        tids[i] = uthread_create(thread, NULL);
+    for(i = 0; i < THREADS; i++)
+        uthread_join(tids[i], NULL);
+
+    /* every yield and the first run of every thread were measured */
+    assert(uthread_latency(&lat) == 0);
+    assert(lat.count >= THREADS * (YIELDS + 1));
+
+    /* percentiles are ordered */
+    assert(lat.min_ns <= lat.p50_ns);
+    assert(lat.p50_ns <= lat.p99_ns);
+    assert(lat.p99_ns <= lat.p999_ns);
+    assert(lat.p999_ns <= lat.max_ns);
+    assert(lat.min_ns <= lat.mean_ns && lat.mean_ns <= lat.max_ns);
+    assert(uthread_latency_percentile(99.0) == lat.p99_ns);
+    assert(uthread_latency_percentile(100.0) == lat.max_ns);
+
+    /* resetting discards the measurements */
+    uthread_latency_reset();
+    assert(uthread_latency(&lat) == 0);
+    assert(lat.count == 0);
+
+    printf("latency OK\n");
+    return 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * Lazy thread creation test
+ *
+ * Tests that threads only get a stack when they run. Main creates a burst of
+ * threads which do not allocate anything until scheduled, then lets them run
+ * one after the other. As each thread exits before the next one starts, its
+ * stack is reused shortly after and only two stacks are ever allocated: the
+ * one of the exiting thread, and the one of the thread starting while the
+ * previous one is still being switched away from.
+ *
+ * Output:
+ * burst of 1000 threads, 0 stacks
+ * 1000 threads ran, 2 stacks
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <uthread.h>
+
+#define THREADS 1000
+
+static int ran = 0;
+
+int thread(void* arg)
+{
+    ran++;
+    return 0;
+}
+
+int main(void)
+{
+    struct uthread_stats s;
+    int i;
+
+    /* a thread preempted before exiting would keep its stack while the next
+     * ones run, so slices outlast the whole test
+     */
+    assert(uthread_set_timeslice(10000000000ULL, 10000000000ULL, 0) == 0);
+
+    /* creating threads does not allocate stacks */
+    for(i = 0; i < THREADS; i++)
+        assert(uthread_create(thread, NULL) == i + 1);
+    uthread_stats(&s);
+    assert(s.stacks == 0);
+    printf("burst of %d threads, %d stacks\n", s.threads - 1, s.stacks);
+
+    /* threads run one after the other, reusing the same stack */
+    for(i = 1; i <= THREADS; i++)
+        assert(uthread_join(i, NULL) == 0);
+    uthread_stats(&s);
+    assert(ran == THREADS);
+    assert(s.stacks == 2);
+    printf("%d threads ran, %d stacks\n", ran, s.stacks);
+
+    return 0;
+}
@@ -0,0 +1,147 @@
+/*
+ * Offload test
+ *
+ * Tests the uthread_offload function and the file-system wrappers. While a
+ * thread sleeps in an offloaded call, another thread keeps running. The
+ * wrappers behave like the calls they wrap, including errno. Several threads
+ * offloading at the same time are all woken up with their own results. A
+ * thread offloading while nothing else can run sleeps rather than spins.
+ *
+ * Output:
+ * other thread ran during the offloaded call
+ * file: 6 bytes
+ * stat: ENOENT
+ * getaddrinfo: 127.0.0.1
+ * 8 concurrent calls completed
+ * lone caller slept
+ */
+
+#include <arpa/inet.h>
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <offload.h>
+#include <uthread.h>
+
+#define CALLERS 8
+
+static int sleeping = 0;
+static int ticks = 0;
+
+long slow_call(void *arg)
+{
+    struct timespec pause = { 0, 20000000 };
+
+    nanosleep(&pause, NULL);
+    return (long)arg;
+}
+
+int ticker(void* arg)
+{
+    while(!sleeping)
+        uthread_yield();
+    while(sleeping)
+    {
+        ticks++;
+        uthread_yield();
+    }
+    return 0;
+}
+
+int sleeper(void* arg)
+{
+    long ret;
+
+    sleeping = 1;
+    ret = uthread_offload(slow_call, (void*)42L);
+    sleeping = 0;
+    assert(ret == 42);
+    return 0;
+}
+
+int caller(void* arg)
+{
+    return uthread_offload(slow_call, arg) == (long)arg ? 0 : -1;
+}
+
+/*
+ * thread_cpu_ns - Get the CPU time of the calling kernel thread
+ */
+static long long thread_cpu_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+int main(void)
+{
+    char path[] = "/tmp/test_offloadXXXXXX";
+    struct addrinfo hints, *res;
+    struct stat st;
+    char addr[INET_ADDRSTRLEN];
+    int fd, i, retval;
+    uthread_t tids[CALLERS];
+
+    /* the other thread runs while the call blocks */
+    tids[0] = uthread_create(ticker, NULL);
+    tids[1] = uthread_create(sleeper, NULL);
+    assert(uthread_join(tids[1], NULL) == 0);
+    assert(uthread_join(tids[0], NULL) == 0);
+    assert(ticks > 0);
+    printf("other thread ran during the offloaded call\n");
+
+    /* file-system wrappers */
+    fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    fd = uthread_open(path, O_WRONLY | O_TRUNC, 0600);
+    assert(fd >= 0);
+    assert(write(fd, "hello\n", 6) == 6);
+    assert(uthread_fsync(fd) == 0);
+    close(fd);
+    assert(uthread_stat(path, &st) == 0);
+    printf("file: %ld bytes\n", (long)st.st_size);
+    unlink(path);
+
+    errno = 0;
+    assert(uthread_stat(path, &st) == -1);
+    assert(errno == ENOENT);
+    printf("stat: ENOENT\n");
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_flags = AI_NUMERICHOST;
+    assert(uthread_getaddrinfo("127.0.0.1", NULL, &hints, &res) == 0);
+    inet_ntop(AF_INET, &((struct sockaddr_in*)res->ai_addr)->sin_addr, addr,
+        sizeof(addr));
+    printf("getaddrinfo: %s\n", addr);
+    freeaddrinfo(res);
+
+    /* more callers than helpers */
+    for(i = 0; i < CALLERS; i++)
+        tids[i] = uthread_create(caller, (void*)(long)i);
+    for(i = 0; i < CALLERS; i++)
+    {
+        assert(uthread_join(tids[i], &retval) == 0);
+        assert(retval == 0);
+    }
+    printf("%d concurrent calls completed\n", CALLERS);
+
+    /* 100ms of calls with nothing else to run barely use the processor */
+    long long cpu = thread_cpu_ns();
+    for(i = 0; i < 5; i++)
+        assert(uthread_offload(slow_call, (void*)(long)i) == i);
+    assert(thread_cpu_ns() - cpu < 50000000LL);
+    printf("lone caller slept\n");
+
+    return 0;
+}
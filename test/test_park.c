@@ -0,0 +1,109 @@
+/*
+ * Park/unpark test
+ *
+ * Tests the uthread_park and uthread_unpark functions. Threads park on a
+ * flag and are woken up one at a time, then all at once, in the order they
+ * parked. Threads parked on other words (some of which share a wait list with
+ * the flag) are not woken up. Parking on a word which does not hold the
+ * expected value, or with no other thread left to wake the caller up, returns
+ * right away.
+ *
+ * Output:
+ * woke 1: 1
+ * woke 4: 1 2 3 4 5
+ * others: 300 woken
+ * deadlock detected
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <uthread.h>
+
+#define WAITERS 5
+#define OTHERS 300
+
+static int flag = 0;
+static int words[OTHERS];
+static int order[WAITERS];
+static int woken = 0;
+
+int waiter(void* arg)
+{
+    while(!flag)
+        uthread_park(&flag, 0);
+    order[woken++] = uthread_self();
+    return 0;
+}
+
+int other(void* arg)
+{
+    int *word = arg;
+
+    while(!*word)
+        uthread_park(word, 0);
+    woken++;
+    return 0;
+}
+
+static void print_order(void)
+{
+    int i;
+
+    for(i = 0; i < woken; i++)
+        printf(" %d", order[i]);
+    printf("\n");
+}
+
+int main(void)
+{
+    int i;
+
+    /* the value changed already */
+    assert(uthread_park(&flag, 1) == -1);
+
+    for(i = 0; i < WAITERS; i++)
+        uthread_create(waiter, NULL);
+    for(i = 0; i < OTHERS; i++)
+        uthread_create(other, &words[i]);
+    uthread_yield();
+    assert(woken == 0);
+
+    /* wake up the first waiter only */
+    flag = 1;
+    assert(uthread_unpark(&flag, 1) == 1);
+    uthread_yield();
+    printf("woke 1:");
+    print_order();
+    assert(woken == 1 && order[0] == 1);
+
+    /* wake up the rest, in order */
+    assert(uthread_unpark(&flag, INT_MAX) == WAITERS - 1);
+    assert(uthread_unpark(&flag, INT_MAX) == 0);
+    uthread_yield();
+    printf("woke %d:", WAITERS - 1);
+    print_order();
+    for(i = 0; i < WAITERS; i++)
+        assert(order[i] == i + 1);
+
+    /* threads parked elsewhere were left alone */
+    woken = 0;
+    for(i = 0; i < OTHERS; i++)
+    {
+        words[i] = 1;
+        assert(uthread_unpark(&words[i], INT_MAX) == 1);
+    }
+    for(i = 1; i <= WAITERS + OTHERS; i++)
+        assert(uthread_join(i, NULL) == 0);
+    printf("others: %d woken\n", woken);
+    assert(woken == OTHERS);
+
+    /* nobody is left to unpark main */
+    flag = 0;
+    assert(uthread_park(&flag, 0) == -1);
+    printf("deadlock detected\n");
+
+    return 0;
+}
@@ -0,0 +1,185 @@
+/*
+ * Worker pool test
+ *
+ * Tests the uthread_pool functions. A batch of tasks is submitted to a pool,
+ * which grows up to its maximum size to run them; every task runs once and
+ * reports its return value through its future, which can also be awaited as
+ * any other future. Running a second batch does not
+ * allocate any new stack. Once the pool has been idle long enough, new
+ * submissions retire the extra workers down to the minimum.
+ *
+ * A pool retiring workers as soon as they are idle is then flooded with
+ * submissions, in rounds of tasks which block until the round ends: every
+ * round needs the pool to grow to its maximum again, and the number of live
+ * workers stays within the bounds of the pool.
+ *
+ * Output:
+ * 1000 tasks, 4 workers
+ * second batch, no new stack
+ * shrunk to 2 workers
+ * 200 flood rounds, at most 8 workers
+ */
+
+#include <assert.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <pool.h>
+#include <uthread.h>
+
+#define TASKS 1000
+#define MIN_WORKERS 2
+#define MAX_WORKERS 4
+#define IDLE_NS 1000000
+#define FLOOD_ROUNDS 200
+#define FLOOD_MAX 8
+#define FLOOD_QUICK 50
+
+static uthread_future_t futures[TASKS];
+static int runs[TASKS];
+
+int task(void* arg)
+{
+    int i = (long)arg;
+
+    runs[i]++;
+    uthread_yield();
+    return i * 2;
+}
+
+static int gate, running, peak;
+
+int blocking_task(void* arg)
+{
+    int round = (long)arg;
+
+    if(++running > peak)
+        peak = running;
+    while(gate == round)
+        uthread_park(&gate, round);
+    running--;
+    return 0;
+}
+
+int quick_task(void* arg)
+{
+    return 0;
+}
+
+/*
+ * flood - Submit rounds of blocking tasks with quick ones in between
+ * @pool: pool of at most FLOOD_MAX workers, retiring idle ones right away
+ */
+static void flood(uthread_pool_t pool)
+{
+    struct uthread_stats s;
+    int round, i, spins;
+
+    for(round = 0; round < FLOOD_ROUNDS; round++)
+    {
+        /* parks fail and wake ups miss while these are picked */
+        for(i = 0; i < FLOOD_QUICK; i++)
+            assert(uthread_pool_submit(pool, quick_task, NULL, NULL) == 0);
+
+        gate = round;
+        for(i = 0; i < FLOOD_MAX; i++)
+            assert(uthread_pool_submit(pool, blocking_task, (void*)(long)round,
+                &futures[i]) == 0);
+
+        /* each blocking task needs a worker of its own */
+        for(spins = 0; running < FLOOD_MAX && spins < 1000; spins++)
+            uthread_yield();
+        assert(running == FLOOD_MAX);
+        assert(uthread_pool_size(pool) >= 1 && uthread_pool_size(pool) <= FLOOD_MAX);
+
+        gate = round + 1;
+        uthread_unpark(&gate, INT_MAX);
+        for(i = 0; i < FLOOD_MAX; i++)
+            assert(uthread_pool_wait(&futures[i], NULL) == 0);
+
+        /* parked or ready workers, retired ones not collected yet aside */
+        uthread_stats(&s);
+        assert(s.ready + s.blocked <= FLOOD_MAX);
+        assert(uthread_pool_size(pool) >= 1 && uthread_pool_size(pool) <= FLOOD_MAX);
+    }
+    assert(peak == FLOOD_MAX);
+}
+
+static void run_batch(uthread_pool_t pool)
+{
+    int i, retval;
+
+    for(i = 0; i < TASKS; i++)
+        assert(uthread_pool_submit(pool, task, (void*)(long)i, &futures[i]) == 0);
+    for(i = 0; i < TASKS; i++)
+    {
+        assert(uthread_pool_wait(&futures[i], &retval) == 0);
+        assert(retval == i * 2);
+    }
+}
+
+static void idle(long ns)
+{
+    struct timespec start, now;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do
+    {
+        uthread_yield();
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    } while((now.tv_sec - start.tv_sec) * 1000000000L +
+        now.tv_nsec - start.tv_nsec < ns);
+}
+
+int main(void)
+{
+    uthread_pool_t pool;
+    struct uthread_stats s;
+    void *value;
+    int i, stacks;
+
+    assert(uthread_pool_create(0, 1, 0) == NULL);
+    assert(uthread_pool_create(2, 1, 0) == NULL);
+
+    pool = uthread_pool_create(MIN_WORKERS, MAX_WORKERS, IDLE_NS);
+    assert(pool);
+    assert(uthread_pool_size(pool) == MIN_WORKERS);
+
+    /* every task runs once, the pool grows to its maximum */
+    run_batch(pool);
+    for(i = 0; i < TASKS; i++)
+        assert(runs[i] == 1);
+    assert(uthread_await(&futures[1], &value, NULL) == 0 && (long)value == 2);
+    printf("%d tasks, %d workers\n", TASKS, uthread_pool_size(pool));
+    assert(uthread_pool_size(pool) == MAX_WORKERS);
+
+    /* workers are reused */
+    uthread_stats(&s);
+    stacks = s.stacks;
+    run_batch(pool);
+    uthread_stats(&s);
+    assert(s.stacks == stacks);
+    printf("second batch, no new stack\n");
+
+    /* extra workers are retired one idle period at a time */
+    for(i = MIN_WORKERS; i < MAX_WORKERS; i++)
+    {
+        idle(2 * IDLE_NS);
+        assert(uthread_pool_submit(pool, task, 0, NULL) == 0);
+    }
+    printf("shrunk to %d workers\n", uthread_pool_size(pool));
+    assert(uthread_pool_size(pool) == MIN_WORKERS);
+
+    assert(uthread_pool_destroy(pool) == 0);
+
+    /* the live workers stay within bounds under a flood of submissions */
+    pool = uthread_pool_create(1, FLOOD_MAX, 0);
+    assert(pool);
+    flood(pool);
+    printf("%d flood rounds, at most %d workers\n", FLOOD_ROUNDS, peak);
+    assert(uthread_pool_destroy(pool) == 0);
+
+    return 0;
+}
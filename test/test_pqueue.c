@@ -0,0 +1,276 @@
+/*
+ * Priority queue test
+ *
+ * Test comprehensively the priority queue API
+ * 
+ */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <pqueue.h>
+
+#define MANY 1000
+
+/*
+ * test_create - Unit test of the pqueue_create function
+ *
+ * Check if the created priority queue is not NULL and empty
+ * Check the priority queue created is destroyed sucessfully
+ */
+void test_create(void)
+{
+    pqueue_t pq;
+    printf("Testing pqueue_create()...\n");
+    pq = pqueue_create();
+    assert(pq != NULL);
+    assert(pqueue_length(pq) == 0);
+    assert(pqueue_destroy(pq) == 0);
+    printf("pqueue_create()...OK!\n\n");
+}
+
+/*
+ * test_destroy - Unit test of the pqueue_destroy function
+ *
+ * Check if the function returns -1 if the priority queue is NULL
+ * Check if the function returns -1 if the priority queue is not empty
+ */
+void test_destroy(void)
+{
+    int data = 1;
+    void *ptr;
+    pqueue_t pq;
+    printf("Testing pqueue_destroy()...\n");
+
+    assert(pqueue_destroy(NULL) == -1);
+
+    pq = pqueue_create();
+    pqueue_push(pq, 1, &data, NULL);
+    assert(pqueue_destroy(pq) == -1);
+
+    pqueue_pop(pq, &ptr, NULL);
+    assert(pqueue_destroy(pq) == 0);
+    printf("pqueue_destroy()...OK!\n\n");
+}
+
+/*
+ * test_push_pop - Unit test of the pqueue_push and pqueue_pop functions
+ *
+ * Check if the functions return -1 when the queue or the data is NULL
+ * Check if the function returns -1 when popping an empty queue
+ * Check if items are popped by increasing keys
+ * case 1: keys = {5, 1, 4, 2, 3}, popped as {1, 2, 3, 4, 5}
+ * case 2: items with equal keys are popped in push order
+ */
+void test_push_pop(void)
+{
+    uint64_t keys[5] = {5, 1, 4, 2, 3}, key;
+    int data[5], i, *ptr;
+    pqueue_t pq;
+    printf("Testing pqueue_push() and pqueue_pop()...\n");
+
+    /* invalid arguments */
+    assert(pqueue_push(NULL, 1, &data[0], NULL) == -1);
+    pq = pqueue_create();
+    assert(pqueue_push(pq, 1, NULL, NULL) == -1);
+    assert(pqueue_pop(pq, (void**)&ptr, NULL) == -1);
+    assert(pqueue_pop(NULL, (void**)&ptr, NULL) == -1);
+
+    /* case 1: popped by increasing keys */
+    for(i = 0; i < 5; i++)
+    {
+        data[i] = keys[i];
+        assert(pqueue_push(pq, keys[i], &data[i], NULL) == 0);
+    }
+    assert(pqueue_pop(pq, NULL, NULL) == -1);
+    for(i = 1; i <= 5; i++)
+    {
+        assert(pqueue_pop(pq, (void**)&ptr, &key) == 0);
+        assert(*ptr == i && key == i);
+    }
+
+    /* case 2: equal keys are popped in push order */
+    for(i = 0; i < 5; i++)
+        pqueue_push(pq, 7, &data[i], NULL);
+    for(i = 0; i < 5; i++)
+    {
+        assert(pqueue_pop(pq, (void**)&ptr, NULL) == 0);
+        assert(ptr == &data[i]);
+    }
+    assert(pqueue_destroy(pq) == 0);
+
+    printf("pqueue_push() and pqueue_pop()...OK!\n\n");
+}
+
+/*
+ * test_peek - Unit test of the pqueue_peek function
+ *
+ * Check if the function returns -1 when the queue is NULL or empty
+ * Check if the function returns the smallest item without removing it
+ */
+void test_peek(void)
+{
+    int data[2] = {1, 2}, *ptr;
+    uint64_t key;
+    pqueue_t pq;
+    printf("Testing pqueue_peek()...\n");
+
+    assert(pqueue_peek(NULL, (void**)&ptr, &key) == -1);
+    pq = pqueue_create();
+    assert(pqueue_peek(pq, (void**)&ptr, &key) == -1);
+
+    pqueue_push(pq, 20, &data[1], NULL);
+    pqueue_push(pq, 10, &data[0], NULL);
+    assert(pqueue_peek(pq, (void**)&ptr, &key) == 0);
+    assert(ptr == &data[0] && key == 10);
+    assert(pqueue_peek(pq, NULL, NULL) == 0);
+    assert(pqueue_length(pq) == 2);
+
+    pqueue_pop(pq, (void**)&ptr, NULL);
+    pqueue_pop(pq, (void**)&ptr, NULL);
+    assert(pqueue_destroy(pq) == 0);
+
+    printf("pqueue_peek()...OK!\n\n");
+}
+
+/*
+ * test_decrease_key - Unit test of the pqueue_decrease_key function
+ *
+ * Check if the function returns -1 when the queue or the handle is NULL
+ * Check if the function returns -1 when the key would increase
+ * Check if an item whose key decreases is popped earlier
+ * case: keys = {10, 20, 30, 40}, 40 decreased to 15, popped as
+ * {10, 15, 20, 30}
+ */
+void test_decrease_key(void)
+{
+    int data[4] = {10, 20, 30, 40}, expected[4] = {0, 3, 1, 2}, i, *ptr;
+    pqueue_handle_t handles[4];
+    uint64_t key;
+    pqueue_t pq;
+    printf("Testing pqueue_decrease_key()...\n");
+
+    pq = pqueue_create();
+    for(i = 0; i < 4; i++)
+        pqueue_push(pq, data[i], &data[i], &handles[i]);
+
+    assert(pqueue_decrease_key(NULL, handles[3], 15) == -1);
+    assert(pqueue_decrease_key(pq, NULL, 15) == -1);
+    assert(pqueue_decrease_key(pq, handles[3], 41) == -1);
+
+    assert(pqueue_decrease_key(pq, handles[3], 15) == 0);
+    for(i = 0; i < 4; i++)
+    {
+        assert(pqueue_pop(pq, (void**)&ptr, &key) == 0);
+        assert(ptr == &data[expected[i]]);
+    }
+    assert(key == 30);
+    assert(pqueue_destroy(pq) == 0);
+
+    printf("pqueue_decrease_key()...OK!\n\n");
+}
+
+/*
+ * test_remove - Unit test of the pqueue_remove function
+ *
+ * Check if the function returns -1 when the queue or the handle is NULL
+ * Check if removed items are never popped, whether they are the smallest,
+ * the largest or in the middle
+ */
+void test_remove(void)
+{
+    int data[5] = {1, 2, 3, 4, 5}, i, *ptr;
+    pqueue_handle_t handles[5];
+    pqueue_t pq;
+    printf("Testing pqueue_remove()...\n");
+
+    pq = pqueue_create();
+    for(i = 0; i < 5; i++)
+        pqueue_push(pq, data[i], &data[i], &handles[i]);
+
+    assert(pqueue_remove(NULL, handles[0]) == -1);
+    assert(pqueue_remove(pq, NULL) == -1);
+
+    assert(pqueue_remove(pq, handles[0]) == 0);
+    assert(pqueue_remove(pq, handles[4]) == 0);
+    assert(pqueue_remove(pq, handles[2]) == 0);
+    assert(pqueue_length(pq) == 2);
+
+    assert(pqueue_pop(pq, (void**)&ptr, NULL) == 0 && ptr == &data[1]);
+    assert(pqueue_pop(pq, (void**)&ptr, NULL) == 0 && ptr == &data[3]);
+    assert(pqueue_destroy(pq) == 0);
+
+    printf("pqueue_remove()...OK!\n\n");
+}
+
+/*
+ * test_many - Test the priority queue with many items
+ *
+ * Push pseudo-random keys, decrease and remove some of them, and check the
+ * items are popped in order
+ */
+void test_many(void)
+{
+    static pqueue_handle_t handles[MANY];
+    static uint64_t keys[MANY];
+    uint64_t key, prev = 0;
+    int i, count = 0;
+    void *ptr;
+    pqueue_t pq;
+    printf("Testing many items...\n");
+
+    pq = pqueue_create();
+    srand(42);
+    for(i = 0; i < MANY; i++)
+    {
+        keys[i] = rand() % 10000;
+        assert(pqueue_push(pq, keys[i], &keys[i], &handles[i]) == 0);
+    }
+
+    /* decrease every third key and remove every seventh item */
+    for(i = 0; i < MANY; i += 3)
+    {
+        keys[i] /= 2;
+        assert(pqueue_decrease_key(pq, handles[i], keys[i]) == 0);
+    }
+    for(i = 0; i < MANY; i += 7)
+        assert(pqueue_remove(pq, handles[i]) == 0);
+
+    while(pqueue_pop(pq, &ptr, &key) == 0)
+    {
+        assert(key >= prev && key == *(uint64_t*)ptr);
+        prev = key;
+        count++;
+    }
+    assert(count == MANY - (MANY + 6) / 7);
+    assert(pqueue_destroy(pq) == 0);
+
+    printf("many items...OK!\n\n");
+}
+
+int main(void)
+{
+    /* test pqueue_create() */
+    test_create();
+
+    /* test pqueue_destroy() */
+    test_destroy();
+
+    /* test pqueue_push() and pqueue_pop() */
+    test_push_pop();
+
+    /* test pqueue_peek() */
+    test_peek();
+
+    /* test pqueue_decrease_key() */
+    test_decrease_key();
+
+    /* test pqueue_remove() */
+    test_remove();
+
+    /* test with many items */
+    test_many();
+    return 0;
+}
@@ -1,7 +1,9 @@
 /*
  * Queue test
  *
- * Test comprehensively the queue API
+ * Test comprehensively the queue API. The test is linked once against each
+ * queue backend: test_queue.x for the linked list and test_queue_ring.x for
+ * the ring buffer.
  * 
  */
 
@@ -488,6 +490,292 @@ void test_length(void)
     printf("queue_length()...OK!\n\n");
 }
 
+/*
+ * test_enqueue_many - Unit test of the queue_enqueue_many function
+ *
+ * Check if the function returns -1 when the queue or the array is NULL
+ * Check if the function returns -1 and leaves the queue untouched when an
+ * item is NULL
+ * Check if the items are enqueued in order after the existing ones
+ */
+void test_enqueue_many(void)
+{
+    int data[8] = {3, 4, 5, 6, 7, 8, 9, 10};
+    void *ptrs[8];
+    queue_t q;
+    int i, ret;
+    printf("Testing queue_enqueue_many()...\n");
+
+    for(i = 0; i < 8; i++)
+        ptrs[i] = &data[i];
+
+    /* Check if the function returns -1 when the queue or the array is NULL */
+    ret = queue_enqueue_many(NULL, ptrs, 8);
+    assert(ret == -1);
+    q = queue_create();
+    ret = queue_enqueue_many(q, NULL, 8);
+    assert(ret == -1);
+    ret = queue_enqueue_many(q, ptrs, -1);
+    assert(ret == -1);
+
+    /* Check the queue is untouched when an item is NULL */
+    ptrs[5] = NULL;
+    ret = queue_enqueue_many(q, ptrs, 8);
+    assert(ret == -1);
+    assert(queue_length(q) == 0);
+    ptrs[5] = &data[5];
+
+    /* Check the items are enqueued in order after the existing ones */
+    queue_enqueue(q, &data[0]);
+    ret = queue_enqueue_many(q, ptrs + 1, 7);
+    assert(ret == 0);
+    assert(queue_length(q) == 8);
+    test_match(data, 8, q);
+
+    printf("queue_enqueue_many()...OK!\n\n");
+}
+
+/*
+ * test_dequeue_many - Unit test of the queue_dequeue_many function
+ *
+ * Check if the function returns -1 when the queue or the array is NULL
+ * Check if the oldest items are dequeued in order
+ * Check if the function returns the number of items when there are less items
+ * than requested
+ */
+void test_dequeue_many(void)
+{
+    int data[8] = {3, 4, 5, 6, 7, 8, 9, 10};
+    void *ptrs[8];
+    queue_t q;
+    int i, ret;
+    printf("Testing queue_dequeue_many()...\n");
+
+    /* Check if the function returns -1 when the queue or the array is NULL */
+    ret = queue_dequeue_many(NULL, ptrs, 8);
+    assert(ret == -1);
+    q = queue_create();
+    ret = queue_dequeue_many(q, NULL, 8);
+    assert(ret == -1);
+
+    /* Check if the oldest items are dequeued in order */
+    enqueue_array(data, 8, q);
+    ret = queue_dequeue_many(q, ptrs, 3);
+    assert(ret == 3);
+    for(i = 0; i < 3; i++)
+        assert(ptrs[i] == &data[i]);
+    assert(queue_length(q) == 5);
+
+    /* Check only the available items are dequeued */
+    ret = queue_dequeue_many(q, ptrs, 8);
+    assert(ret == 5);
+    for(i = 0; i < 5; i++)
+        assert(ptrs[i] == &data[i + 3]);
+    ret = queue_dequeue_many(q, ptrs, 8);
+    assert(ret == 0);
+    assert(queue_destroy(q) == 0);
+
+    printf("queue_dequeue_many()...OK!\n\n");
+}
+
+/*
+ * test_splice - Unit test of the queue_splice function
+ *
+ * Check if the function returns -1 when a queue is NULL or both are the same
+ * Check if the items are appended in order and the source queue is emptied
+ * Check splicing an empty queue and into an empty queue
+ */
+void test_splice(void)
+{
+    int data[8] = {3, 4, 5, 6, 7, 8, 9, 10};
+    queue_t q, from;
+    int ret;
+    printf("Testing queue_splice()...\n");
+
+    /* Check if the function returns -1 when a queue is NULL or both are the same */
+    q = queue_create();
+    from = queue_create();
+    ret = queue_splice(NULL, from);
+    assert(ret == -1);
+    ret = queue_splice(q, NULL);
+    assert(ret == -1);
+    ret = queue_splice(q, q);
+    assert(ret == -1);
+
+    /* Check if the items are appended in order and from is emptied */
+    enqueue_array(data, 3, q);
+    enqueue_array(data + 3, 5, from);
+    ret = queue_splice(q, from);
+    assert(ret == 0);
+    assert(queue_length(q) == 8);
+    assert(queue_length(from) == 0);
+
+    /* Check splicing an empty queue */
+    ret = queue_splice(q, from);
+    assert(ret == 0);
+    assert(queue_length(q) == 8);
+
+    /* Check splicing into an empty queue */
+    ret = queue_splice(from, q);
+    assert(ret == 0);
+    assert(queue_length(q) == 0);
+    assert(queue_destroy(q) == 0);
+    test_match(data, 8, from);
+
+    printf("queue_splice()...OK!\n\n");
+}
+
+/*
+ * test_remove_handle - Unit test of the queue_remove_handle function
+ *
+ * Check if the function returns -1 when the queue or the handle is NULL
+ * Check if the items designated by handles are removed from the queue, at
+ * the head, in the middle and at the tail, and the others kept in order
+ * case 1: queue = {3, 4, 5, 6, 7, 8, 9, 10}, after removing 3, 6 and 10,
+ * queue = {4, 5, 7, 8, 9}
+ * case 2: removing the only item of a queue
+ */
+void test_remove_handle(void)
+{
+    int data[8] = {3, 4, 5, 6, 7, 8, 9, 10}, expected[5] = {1, 2, 4, 5, 6};
+    queue_handle_t handles[8];
+    queue_t q;
+    int i, ret, *ptr;
+    printf("Testing queue_remove_handle()...\n");
+
+    /* Check if the function returns -1 when the queue or the handle is NULL */
+    q = queue_create();
+    ret = queue_enqueue_handle(q, &data[0], &handles[0]);
+    assert(ret == 0);
+    ret = queue_remove_handle(NULL, handles[0]);
+    assert(ret == -1);
+    ret = queue_remove_handle(q, NULL);
+    assert(ret == -1);
+
+    /* case 1: remove the head, an item in the middle and the tail */
+    for(i = 1; i < 8; i++)
+    {
+        ret = queue_enqueue_handle(q, &data[i], &handles[i]);
+        assert(ret == 0);
+    }
+    assert(queue_remove_handle(q, handles[0]) == 0);
+    assert(queue_remove_handle(q, handles[3]) == 0);
+    assert(queue_remove_handle(q, handles[7]) == 0);
+    assert(queue_length(q) == 5);
+
+    for(i = 0; i < 5; i++)
+    {
+        ret = queue_dequeue(q, (void**)&ptr);
+        assert(ret == 0 && ptr == &data[expected[i]]);
+    }
+
+    /* case 2: remove the only item, then the queue is usable again */
+    ret = queue_enqueue_handle(q, &data[0], &handles[0]);
+    assert(ret == 0);
+    assert(queue_remove_handle(q, handles[0]) == 0);
+    assert(queue_length(q) == 0);
+    ret = queue_enqueue_handle(q, &data[1], NULL);
+    assert(ret == 0);
+    test_match(data + 1, 1, q);
+
+    printf("queue_remove_handle()...OK!\n\n");
+}
+
+/*
+ * test_many - Test the queue with many items
+ *
+ * Check the order is kept when the queue wraps around and grows
+ * Check deletion in a queue that wrapped around
+ */
+void test_many(void)
+{
+    int data[100], i, ret, *ptr;
+    queue_t q;
+
+    printf("Testing many items...\n");
+    q = queue_create();
+
+    /* case 1: shift the oldest item forward, then grow while wrapped */
+    enqueue_array(data, 10, q);
+    for(i = 0; i < 10; i++)
+    {
+        ret = queue_dequeue(q, (void**)&ptr);
+        assert(ret == 0 && ptr == &data[i]);
+    }
+    enqueue_array(data, 100, q);
+    assert(queue_length(q) == 100);
+
+    /* case 2: delete close to the head and close to the tail */
+    assert(queue_delete(q, &data[3]) == 0);
+    assert(queue_delete(q, &data[95]) == 0);
+    assert(queue_length(q) == 98);
+
+    for(i = 0; i < 100; i++)
+    {
+        if(i == 3 || i == 95)
+            continue;
+        ret = queue_dequeue(q, (void**)&ptr);
+        assert(ret == 0 && ptr == &data[i]);
+    }
+    assert(queue_destroy(q) == 0);
+
+    printf("many items...OK!\n\n");
+}
+
+/*
+ * test_remove_churn - Test removing items from the middle of the queue
+ *
+ * Check the handles obtained before many removals still designate their
+ * items, and the order of the items is kept
+ * case 1: queue = {x, y, z}, the item after x is removed and enqueued again
+ * many times, x is removed last with its first handle
+ * case 2: queue = {0, ..., 99}, the odd items are removed, then the even ones
+ * from the tail to the head
+ */
+void test_remove_churn(void)
+{
+    int data[100], i, ret, *ptr;
+    queue_handle_t handles[100], first;
+    queue_t q;
+
+    printf("Testing removal churn...\n");
+    q = queue_create();
+
+    /* case 1: x stays at the head while the other items keep moving */
+    ret = queue_enqueue_handle(q, &data[0], &first);
+    assert(ret == 0);
+    assert(queue_enqueue_handle(q, &data[1], &handles[1]) == 0);
+    assert(queue_enqueue_handle(q, &data[2], &handles[2]) == 0);
+    for(i = 0; i < 1000000; i++)
+    {
+        assert(queue_remove_handle(q, handles[1 + i % 2]) == 0);
+        ret = queue_enqueue_handle(q, &data[1 + i % 2], &handles[1 + i % 2]);
+        assert(ret == 0);
+    }
+    assert(queue_length(q) == 3);
+    assert(queue_remove_handle(q, first) == 0);
+    assert(queue_length(q) == 2);
+    test_match(data + 1, 2, q);
+
+    /* case 2: the remaining items moved, their handles did not */
+    q = queue_create();
+    for(i = 0; i < 100; i++)
+        assert(queue_enqueue_handle(q, &data[i], &handles[i]) == 0);
+    for(i = 1; i < 100; i += 2)
+        assert(queue_remove_handle(q, handles[i]) == 0);
+    for(i = 98; i >= 10; i -= 2)
+        assert(queue_remove_handle(q, handles[i]) == 0);
+    assert(queue_length(q) == 5);
+    for(i = 0; i < 10; i += 2)
+    {
+        ret = queue_dequeue(q, (void**)&ptr);
+        assert(ret == 0 && ptr == &data[i]);
+    }
+    assert(queue_destroy(q) == 0);
+
+    printf("removal churn...OK!\n\n");
+}
+
 int main(void)
 {
     /* test queue_create() */
@@ -502,13 +790,31 @@ int main(void)
     /* test queue_dequeue() */
     test_dequeue();
     
+    /* test queue_enqueue_many() */
+    test_enqueue_many();
+
+    /* test queue_dequeue_many() */
+    test_dequeue_many();
+
+    /* test queue_splice() */
+    test_splice();
+
     /* test queue_delete() */
     test_delete();
 
+    /* test queue_remove_handle() */
+    test_remove_handle();
+
     /* test queue_iterate() */
     test_iterate();
 
     /* test queue_length() */
     test_length();
+
+    /* test with many items */
+    test_many();
+
+    /* test removing from the middle many times */
+    test_remove_churn();
     return 0;
 }
@@ -0,0 +1,96 @@
+/*
+ * Remote submission test
+ *
+ * Tests the uthread_submit and uthread_unpark_remote functions. A pthread
+ * which does not use the library submits tasks to the scheduler of the main
+ * kernel thread, pausing now and then so that the scheduler runs out of
+ * threads and sleeps waiting for more. The main thread waits for all the
+ * tasks, then for a flag set by the pthread. Without waiting for remote
+ * requests, parking with no other thread to run reports a deadlock.
+ *
+ * Output:
+ * deadlock detected
+ * 100 tasks ran
+ * woken by remote unpark
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <uthread.h>
+
+#define TASKS 100
+
+static uthread_sched_t main_sched;
+static int done = 0;
+static int flag = 0;
+static uthread_t last_tid;
+
+int noop(void* arg)
+{
+    return 0;
+}
+
+int task(void* arg)
+{
+    last_tid = uthread_self();
+    done++;
+    uthread_unpark(&done, 1);
+    return 0;
+}
+
+void *producer(void *arg)
+{
+    struct timespec pause = { 0, 100000 };
+    long i;
+
+    for(i = 0; i < TASKS; i++)
+    {
+        assert(uthread_submit(main_sched, task, (void*)i) == 0);
+        if(i % 10 == 0)
+            nanosleep(&pause, NULL);
+    }
+
+    /* let the main thread fall asleep before setting the flag */
+    nanosleep(&pause, NULL);
+    __atomic_store_n(&flag, 1, __ATOMIC_RELEASE);
+    assert(uthread_unpark_remote(main_sched, &flag, 1) == 0);
+
+    return NULL;
+}
+
+int main(void)
+{
+    pthread_t pthread;
+    int d;
+
+    /* nothing could wake the main thread up */
+    assert(uthread_join(uthread_create(noop, NULL), NULL) == 0);
+    assert(uthread_park(&flag, 0) == -1);
+    printf("deadlock detected\n");
+
+    main_sched = uthread_sched_self();
+    assert(main_sched);
+    assert(uthread_remote_enable(1) == 0);
+    assert(uthread_submit(NULL, task, NULL) == -1);
+    assert(uthread_submit(main_sched, NULL, NULL) == -1);
+
+    assert(pthread_create(&pthread, NULL, producer, NULL) == 0);
+
+    while((d = done) < TASKS)
+        assert(uthread_park(&done, d) == 0 || done != d);
+    printf("%d tasks ran\n", done);
+
+    /* submitted threads are not joinable */
+    assert(uthread_join(last_tid, NULL) == -1);
+
+    while(!__atomic_load_n(&flag, __ATOMIC_ACQUIRE))
+        assert(uthread_park(&flag, 0) == 0);
+    printf("woken by remote unpark\n");
+
+    assert(pthread_join(pthread, NULL) == 0);
+    return 0;
+}
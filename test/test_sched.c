@@ -0,0 +1,150 @@
+/*
+ * Scheduler instances test
+ *
+ * Tests that schedulers running on different kernel threads are independent.
+ * The main kernel thread runs the default scheduler while two pthreads each
+ * attach a scheduler of their own, and all three create and run the same
+ * batch of yielding threads at the same time. Each scheduler hands out its own
+ * TIDs and only counts its own threads. Schedulers cannot be destroyed while
+ * they have threads left, nor while attached to another kernel thread.
+ *
+ * Every scheduler then runs a thread spinning until another thread of the
+ * same scheduler stops it, which requires each kernel thread to be preempted
+ * by its own timer.
+ *
+ * Output:
+ * scheduler 0: 100 threads, 1000 yields
+ * scheduler 1: 100 threads, 1000 yields
+ * scheduler 2: 100 threads, 1000 yields
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <uthread.h>
+
+#define SCHEDS 3
+#define THREADS 100
+#define ROUNDS 10
+
+struct run {
+    uthread_sched_t sched;
+    int yields;
+    int threads;
+    volatile int stopped;
+};
+
+static struct run runs[SCHEDS];
+
+int thread(void* arg)
+{
+    struct run *run = arg;
+    int i;
+
+    for(i = 0; i < ROUNDS; i++)
+    {
+        run->yields++;
+        uthread_yield();
+    }
+    return 0;
+}
+
+int spinner(void* arg)
+{
+    struct run *run = arg;
+
+    /* only a preemption lets the stopper run */
+    while(!run->stopped)
+        ;
+    return 0;
+}
+
+int stopper(void* arg)
+{
+    struct run *run = arg;
+
+    run->stopped = 1;
+    return 0;
+}
+
+/*
+ * run_threads - Create and collect a batch of threads on the current scheduler
+ * @run: counters of the scheduler
+ */
+static void run_threads(struct run *run)
+{
+    struct uthread_stats s;
+    int i, retval;
+
+    for(i = 1; i <= THREADS; i++)
+        assert(uthread_create(thread, run) == i);
+
+    /* a scheduler with threads left cannot go away */
+    assert(uthread_sched_destroy(uthread_sched_self()) == -1);
+
+    for(i = 1; i <= THREADS; i++)
+    {
+        assert(uthread_join(i, &retval) == 0);
+        assert(retval == 0);
+    }
+
+    uthread_stats(&s);
+    run->threads = s.threads - 1;
+
+    /* the spinner is created first and runs first */
+    assert(uthread_create(spinner, run) == THREADS + 1);
+    assert(uthread_create(stopper, run) == THREADS + 2);
+    assert(uthread_join(THREADS + 1, NULL) == 0);
+    assert(uthread_join(THREADS + 2, NULL) == 0);
+    assert(run->stopped);
+}
+
+void *kernel_thread(void *arg)
+{
+    struct run *run = arg;
+
+    assert(uthread_sched_self() == NULL);
+    assert(uthread_sched_attach(run->sched) == 0);
+    assert(uthread_sched_self() == run->sched);
+
+    /* a kernel thread has at most one scheduler */
+    assert(uthread_sched_attach(run->sched) == -1);
+
+    run_threads(run);
+
+    assert(uthread_sched_destroy(run->sched) == 0);
+    assert(uthread_sched_self() == NULL);
+    return NULL;
+}
+
+int main(void)
+{
+    pthread_t pthreads[SCHEDS];
+    int i;
+
+    for(i = 1; i < SCHEDS; i++)
+    {
+        runs[i].sched = uthread_sched_create();
+        assert(runs[i].sched);
+        assert(pthread_create(&pthreads[i], NULL, kernel_thread, &runs[i]) == 0);
+    }
+
+    /* the main kernel thread gets the default scheduler */
+    run_threads(&runs[0]);
+    assert(uthread_sched_destroy(uthread_sched_self()) == -1);
+
+    for(i = 1; i < SCHEDS; i++)
+        assert(pthread_join(pthreads[i], NULL) == 0);
+
+    for(i = 0; i < SCHEDS; i++)
+    {
+        assert(runs[i].threads == THREADS);
+        assert(runs[i].yields == THREADS * ROUNDS);
+        printf("scheduler %d: %d threads, %d yields\n", i, runs[i].threads,
+            runs[i].yields);
+    }
+
+    return 0;
+}
@@ -0,0 +1,202 @@
+/*
+ * Channel and select test
+ *
+ * Tests channels and the uthread_select function. Values go through buffered
+ * and unbuffered channels in order. A server selects over several channels
+ * fed by different producers and gets every value exactly once, and the
+ * registrations of the cases which did not fire are gone once it returns. A
+ * select without ready case returns right away with no timeout, or after the
+ * timeout. A value sent once a select timed out, but before it returned, stays
+ * in the channel. Closing a channel lets receivers drain it, then fails them.
+ *
+ * Output:
+ * buffered: 1 2 3
+ * rendezvous: 10 values
+ * select: 3 channels, 30 values
+ * default case taken
+ * timeout after 5 ms
+ * late send kept
+ * closed: 2 values drained
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <preempt.h>
+#include <uthread.h>
+
+#define SOURCES 3
+#define VALUES 10
+
+static uthread_chan_t chans[SOURCES];
+
+int producer(void* arg)
+{
+    uthread_chan_t chan = arg;
+    long i;
+
+    for(i = 1; i <= VALUES; i++)
+        assert(uthread_chan_send(chan, (void*)i) == 0);
+    return 0;
+}
+
+int server(void* arg)
+{
+    struct uthread_select_case cases[SOURCES];
+    long sums[SOURCES] = { 0 };
+    int i, fired, received = 0;
+
+    for(i = 0; i < SOURCES; i++)
+    {
+        cases[i].chan = chans[i];
+        cases[i].op = UTHREAD_SELECT_RECV;
+    }
+
+    while(received < SOURCES * VALUES)
+    {
+        fired = uthread_select(cases, SOURCES, -1);
+        assert(fired >= 0 && fired < SOURCES && cases[fired].ok);
+        sums[fired] += (long)cases[fired].value;
+        received++;
+    }
+
+    /* every value of every producer, exactly once */
+    for(i = 0; i < SOURCES; i++)
+        assert(sums[i] == VALUES * (VALUES + 1) / 2);
+    return received;
+}
+
+int timed_recv(void* arg)
+{
+    struct uthread_select_case c = { arg, UTHREAD_SELECT_RECV, NULL, 0 };
+
+    return uthread_select(&c, 1, 1000000);
+}
+
+int late_sender(void* arg)
+{
+    return uthread_chan_send(arg, (void*)1L);
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+int main(void)
+{
+    struct uthread_select_case cases[2];
+    uthread_chan_t chan, other;
+    uthread_t tids[SOURCES + 1];
+    void *value;
+    double start;
+    int i, retval;
+
+    /* buffered values come out in order */
+    chan = uthread_chan_create(3);
+    assert(chan);
+    for(i = 1; i <= 3; i++)
+        assert(uthread_chan_send(chan, (void*)(long)i) == 0);
+    printf("buffered:");
+    for(i = 1; i <= 3; i++)
+    {
+        assert(uthread_chan_recv(chan, &value) == 0);
+        assert((long)value == i);
+        printf(" %ld", (long)value);
+    }
+    printf("\n");
+    assert(uthread_chan_destroy(chan) == 0);
+
+    /* an unbuffered channel hands values over directly */
+    chan = uthread_chan_create(0);
+    tids[0] = uthread_create(producer, chan);
+    for(i = 1; i <= VALUES; i++)
+    {
+        assert(uthread_chan_recv(chan, &value) == 0);
+        assert((long)value == i);
+    }
+    assert(uthread_join(tids[0], NULL) == 0);
+    printf("rendezvous: %d values\n", VALUES);
+
+    /* one server, several sources */
+    for(i = 0; i < SOURCES; i++)
+        chans[i] = uthread_chan_create(i);
+    tids[SOURCES] = uthread_create(server, NULL);
+    for(i = 0; i < SOURCES; i++)
+        tids[i] = uthread_create(producer, chans[i]);
+    assert(uthread_join(tids[SOURCES], &retval) == 0);
+    for(i = 0; i < SOURCES; i++)
+        assert(uthread_join(tids[i], NULL) == 0);
+
+    /* the losing registrations were taken out */
+    for(i = 0; i < SOURCES; i++)
+        assert(uthread_chan_destroy(chans[i]) == 0);
+    printf("select: %d channels, %d values\n", SOURCES, retval);
+
+    /* no case can proceed */
+    other = uthread_chan_create(0);
+    cases[0].chan = chan;
+    cases[0].op = UTHREAD_SELECT_RECV;
+    cases[1].chan = other;
+    cases[1].op = UTHREAD_SELECT_SEND;
+    cases[1].value = NULL;
+    assert(uthread_select(cases, 2, 0) == UTHREAD_SELECT_TIMEOUT);
+    printf("default case taken\n");
+
+    /* a case firing first cancels the timeout */
+    tids[0] = uthread_create(producer, chan);
+    for(i = 1; i <= VALUES; i++)
+    {
+        assert(uthread_select(cases, 2, 1000000000LL) == 0);
+        assert((long)cases[0].value == i);
+    }
+    assert(uthread_join(tids[0], NULL) == 0);
+
+    start = now_ms();
+    assert(uthread_select(cases, 2, 5000000) == UTHREAD_SELECT_TIMEOUT);
+    assert(now_ms() - start >= 5);
+    printf("timeout after 5 ms\n");
+    assert(uthread_chan_destroy(other) == 0);
+    assert(uthread_chan_destroy(chan) == 0);
+
+    /* the sender runs after the timeout expired but before the receiver
+     * does, nothing can run while the timeout expires
+     */
+    chan = uthread_chan_create(1);
+    tids[0] = uthread_create(timed_recv, chan);
+    uthread_yield();
+    preempt_disable();
+    start = now_ms();
+    while(now_ms() - start < 5)
+        ;
+    tids[1] = uthread_create(late_sender, chan);
+    assert(uthread_join(tids[1], &retval) == 0 && retval == 0);
+    assert(uthread_join(tids[0], &retval) == 0);
+    assert(retval == UTHREAD_SELECT_TIMEOUT);
+    cases[0].chan = chan;
+    assert(uthread_select(cases, 1, 0) == 0 && (long)cases[0].value == 1);
+    printf("late send kept\n");
+    assert(uthread_chan_destroy(chan) == 0);
+
+    /* closing keeps the buffered values */
+    chan = uthread_chan_create(2);
+    assert(uthread_chan_send(chan, (void*)1L) == 0);
+    assert(uthread_chan_send(chan, (void*)2L) == 0);
+    assert(uthread_chan_close(chan) == 0);
+    assert(uthread_chan_close(chan) == -1);
+    assert(uthread_chan_send(chan, (void*)3L) == -1);
+    assert(uthread_chan_recv(chan, &value) == 0 && (long)value == 1);
+    assert(uthread_chan_recv(chan, &value) == 0 && (long)value == 2);
+    assert(uthread_chan_recv(chan, &value) == -1);
+    cases[0].chan = chan;
+    assert(uthread_select(cases, 1, -1) == 0 && cases[0].ok == 0);
+    printf("closed: 2 values drained\n");
+    assert(uthread_chan_destroy(chan) == 0);
+
+    return 0;
+}
@@ -0,0 +1,81 @@
+/*
+ * Stack profiling test
+ *
+ * Tests the uthread_stack_profile functions. Threads running a function with
+ * a large stack frame and threads running a function with a small one are
+ * measured separately, and each function is credited with a usage matching
+ * its frame. The threads reuse the same few stacks, which are painted again
+ * after each measure.
+ *
+ * Output:
+ * 2 functions measured
+ * deep: 50 threads, over 8 KiB
+ * shallow: 50 threads, under 8 KiB
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <uthread.h>
+
+#define THREADS 50
+#define DEEP 8192
+
+int deep(void* arg)
+{
+    volatile char frame[DEEP];
+
+    memset((char*)frame, 0, sizeof(frame));
+    return frame[0];
+}
+
+int shallow(void* arg)
+{
+    return 0;
+}
+
+int main(void)
+{
+    struct uthread_stack_usage usage[4];
+    int i, count;
+
+    uthread_stack_profile_enable(1);
+
+    /* interleave both kinds so they share stacks */
+    for(i = 0; i < THREADS; i++)
+    {
+        uthread_join(uthread_create(deep, NULL), NULL);
+        uthread_join(uthread_create(shallow, NULL), NULL);
+    }
+    uthread_yield();
+
+    count = uthread_stack_profile(usage, 4);
+    printf("%d functions measured\n", count);
+    assert(count == 2);
+
+    for(i = 0; i < count; i++)
+    {
+        assert(usage[i].threads == THREADS);
+        assert(usage[i].max_bytes < 32768);
+        assert(usage[i].mean_bytes <= usage[i].max_bytes);
+        if(usage[i].func == deep)
+        {
+            assert(usage[i].mean_bytes > DEEP);
+            printf("deep: %lu threads, over 8 KiB\n", usage[i].threads);
+        }
+        else
+        {
+            assert(usage[i].func == shallow);
+            assert(usage[i].max_bytes < DEEP);
+            printf("shallow: %lu threads, under 8 KiB\n", usage[i].threads);
+        }
+    }
+
+    uthread_stack_profile_dump(STDERR_FILENO);
+    assert(uthread_stack_profile(NULL, 1) == -1);
+
+    return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * Scheduler statistics test
+ *
+ * Tests the statistics API. Main creates two threads which yield a few times
+ * each before exiting, while main joins them. Every switch is voluntary
+ * unless the preemption timer happens to fire, so the test checks the switch
+ * counters add up and that time accounting was performed.
+ *
+ * A dump is then requested by signal while a second kernel thread runs a
+ * scheduler of its own, and both schedulers must dump their statistics.
+ *
+ * Output:
+ * thread1 yield 1
+ * thread2 yield 1
+ * thread1 yield 2
+ * thread2 yield 2
+ * thread1 yield 3
+ * thread2 yield 3
+ * stats OK
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <uthread.h>
+
+#define YIELDS 3
+
+int thread(void* arg)
+{
+    int i;
+
+    for(i = 1; i <= YIELDS; i++)
+    {
+        printf("thread%d yield %d\n", uthread_self(), i);
+        uthread_yield();
+    }
+    return 0;
+}
+
+static int attached, requested;
+
+int quiet_thread(void* arg)
+{
+    return 0;
+}
+
+/*
+ * kernel_thread - Run a scheduler until a dump was requested
+ * @arg: unused
+ */
+void *kernel_thread(void *arg)
+{
+    uthread_t tid = uthread_create(quiet_thread, NULL);
+
+    __atomic_store_n(&attached, 1, __ATOMIC_RELEASE);
+    while(!__atomic_load_n(&requested, __ATOMIC_ACQUIRE))
+        sched_yield();
+
+    /* the dump happens at the scheduling point of the join */
+    uthread_join(tid, NULL);
+    return NULL;
+}
+
+/*
+ * count_dumps - Count the statistics dumps written to a pipe
+ * @fd: read end of the pipe
+ */
+int count_dumps(int fd)
+{
+    char buf[4096], *p;
+    ssize_t len;
+    int count = 0;
+
+    len = read(fd, buf, sizeof(buf) - 1);
+    assert(len > 0);
+    buf[len] = '\0';
+    for(p = buf; (p = strstr(p, " threads, ")); p++)
+        count++;
+    return count;
+}
+
+int main(void)
+{
+    struct uthread_thread_stats ts;
+    struct uthread_stats s;
+    uthread_t tid1, tid2;
+
+    /* the global statistics are empty before anything happens */
+    assert(uthread_stats(&s) == 0);
+    assert(s.switches == 0 && s.threads == 0);
+    assert(uthread_stats(NULL) == -1);
+
+    uthread_stats_enable(1);
+
+    tid1 = uthread_create(thread, NULL);
+    tid2 = uthread_create(thread, NULL);
+
+    /* both threads are waiting in the ready queue */
+    assert(uthread_stats(&s) == 0);
+    assert(s.threads == 3 && s.ready == 2 && s.blocked == 0);
+
+    uthread_join(tid1, NULL);
+    uthread_join(tid2, NULL);
+
+    /* each thread was switched out once per yield and once when exiting */
+    assert(uthread_thread_stats(tid1, &ts) == 0);
+    assert(ts.switches == ts.voluntary + ts.preempted);
+    assert(ts.voluntary == YIELDS + 1);
+    assert(ts.run_ns > 0 && ts.wait_ns > 0);
+
+    /* main was blocked in its first join */
+    assert(uthread_thread_stats(0, &ts) == 0);
+    assert(ts.voluntary >= 1 && ts.join_ns > 0);
+
+    /* the global counters are the sum of the per-thread ones */
+    assert(uthread_stats(&s) == 0);
+    assert(s.switches == s.voluntary + s.preempted);
+    assert(s.voluntary >= 2 * (YIELDS + 1) + 1);
+    assert(s.ready == 0 && s.zombie == 0);
+
+    /* unknown threads */
+    assert(uthread_thread_stats(tid2 + 1, &ts) == -1);
+    assert(uthread_thread_stats(tid1, NULL) == -1);
+
+    /* the preemption signal cannot be used to request dumps */
+    assert(uthread_stats_dump_on(SIGVTALRM, STDOUT_FILENO) == -1);
+
+    /* a request by signal is served by every scheduler */
+    pthread_t pthread;
+    int fds[2];
+    assert(pipe(fds) == 0);
+    assert(uthread_stats_dump_on(SIGUSR1, fds[1]) == 0);
+    assert(pthread_create(&pthread, NULL, kernel_thread, NULL) == 0);
+    while(!__atomic_load_n(&attached, __ATOMIC_ACQUIRE))
+        sched_yield();
+    raise(SIGUSR1);
+    __atomic_store_n(&requested, 1, __ATOMIC_RELEASE);
+    uthread_yield();
+    pthread_join(pthread, NULL);
+    assert(count_dumps(fds[0]) == 2);
+
+    printf("stats OK\n");
+    return 0;
+}
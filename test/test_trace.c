@@ -0,0 +1,130 @@
+/*
+ * Scheduler tracing test
+ *
+ * Tests the event tracing. Main records the execution of two threads which
+ * yield to each other and dumps the trace. When the library is built with
+ * `make TRACE=1`, the dump must contain the creation, exit and switch events
+ * of the threads. Otherwise, tracing must report being unavailable.
+ *
+ * A second kernel thread then records on its own scheduler, and the dump must
+ * show both schedulers as separate processes.
+ *
+ * Output:
+ * thread1
+ * thread2
+ * thread1
+ * thread2
+ * trace OK
+ */
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <trace.h>
+#include <uthread.h>
+
+#define TRACE_FILE "test_trace.json"
+
+int thread(void* arg)
+{
+    printf("thread%d\n", uthread_self());
+    uthread_yield();
+    printf("thread%d\n", uthread_self());
+    return 0;
+}
+
+/*
+ * count_matches - Count the lines of the dump containing a pattern
+ * @pattern: text to look for
+ */
+int count_matches(const char *pattern)
+{
+    char line[256];
+    int count = 0;
+    FILE *f;
+
+    f = fopen(TRACE_FILE, "r");
+    assert(f);
+    while(fgets(line, sizeof(line), f))
+        if(strstr(line, pattern))
+            count++;
+    fclose(f);
+    return count;
+}
+
+/*
+ * count_events - Count the occurrences of an event name in the dump
+ * @name: name of the event
+ */
+int count_events(const char *name)
+{
+    char pattern[64];
+
+    snprintf(pattern, sizeof(pattern), "\"name\":\"%s\"", name);
+    return count_matches(pattern);
+}
+
+int quiet_thread(void* arg)
+{
+    uthread_yield();
+    return 0;
+}
+
+/*
+ * kernel_thread - Record one thread on a scheduler of its own
+ * @arg: unused
+ */
+void *kernel_thread(void *arg)
+{
+    assert(uthread_trace_enable(1) == 0);
+    uthread_join(uthread_create(quiet_thread, NULL), NULL);
+    return NULL;
+}
+
+int main(void)
+{
+    uthread_t tid1, tid2;
+    int traced;
+
+    traced = uthread_trace_enable(1) == 0;
+
+    tid1 = uthread_create(thread, NULL);
+    tid2 = uthread_create(thread, NULL);
+    uthread_join(tid1, NULL);
+    uthread_join(tid2, NULL);
+
+    /* tracing compiled out */
+    if(!traced)
+    {
+        assert(uthread_trace_dump(TRACE_FILE) == -1);
+        printf("trace OK\n");
+        return 0;
+    }
+
+    assert(uthread_trace_dump(TRACE_FILE) == 0);
+    assert(uthread_trace_dump("/nonexistent/trace.json") == -1);
+
+    assert(count_events("create") == 2);
+    assert(count_events("exit") == 2);
+    assert(count_events("join_block") >= 1);
+    assert(count_events("wake") >= 1);
+    assert(count_events("running") >= 8);
+    assert(count_matches("\"pid\":2") == 0);
+
+    /* events of another scheduler are dumped as another process */
+    pthread_t pthread;
+    assert(pthread_create(&pthread, NULL, kernel_thread, NULL) == 0);
+    pthread_join(pthread, NULL);
+
+    assert(uthread_trace_dump(TRACE_FILE) == 0);
+    assert(count_events("create") == 3);
+    assert(count_matches("\"name\":\"create\",\"ph\":\"i\",\"s\":\"t\",\"pid\":2") == 1);
+    assert(count_matches("\"name\":\"process_name\"") == 2);
+    remove(TRACE_FILE);
+
+    printf("trace OK\n");
+    return 0;
+}
@@ -0,0 +1,65 @@
+/*
+ * Directed yield test
+ *
+ * Tests the uthread_yield_to function. Main creates three threads and hands
+ * off to the last one, which runs ahead of the two others. The same is done
+ * with threads created in a batch. Handing off to the caller itself, to an
+ * exited thread or to an unknown thread falls back to a regular yield.
+ *
+ * Output:
+ * handoff order: 3 1 2
+ * batch handoff order: 6 4 5
+ * fallback ok
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <uthread.h>
+
+static int order[8];
+static int ran = 0;
+
+int thread(void* arg)
+{
+    order[ran++] = uthread_self();
+    return 0;
+}
+
+int main(void)
+{
+    uthread_t tids[3];
+    int i;
+
+    /* thread 3 runs first, then the queue order is resumed */
+    for(i = 0; i < 3; i++)
+        uthread_create(thread, NULL);
+    assert(uthread_yield_to(3) == 0);
+    printf("handoff order:");
+    for(i = 0; i < ran; i++)
+        printf(" %d", order[i]);
+    printf("\n");
+    assert(ran == 3 && order[0] == 3 && order[1] == 1 && order[2] == 2);
+
+    /* threads created in a batch can be handed off to as well */
+    ran = 0;
+    assert(uthread_create_n(thread, NULL, 3, tids) == 3);
+    assert(uthread_yield_to(tids[2]) == 0);
+    printf("batch handoff order:");
+    for(i = 0; i < ran; i++)
+        printf(" %d", order[i]);
+    printf("\n");
+    assert(ran == 3 && order[0] == tids[2] && order[1] == tids[0]);
+
+    /* not ready threads fall back to a regular yield */
+    assert(uthread_yield_to(uthread_self()) == -1);
+    assert(uthread_yield_to(3) == -1);
+    assert(uthread_yield_to(60000) == -1);
+    printf("fallback ok\n");
+
+    for(i = 1; i <= 6; i++)
+        uthread_join(i, NULL);
+
+    return 0;
+}